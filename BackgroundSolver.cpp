@@ -0,0 +1,108 @@
+#include "BackgroundSolver.h"
+
+#include <chrono>
+#include <exception>
+
+BackgroundSolver::BackgroundSolver(CrossField &field)
+	: field(field), worker([this]
+						   { run(); })
+{
+}
+
+BackgroundSolver::~BackgroundSolver()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		cancel_solve = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+unsigned BackgroundSolver::submit(std::vector<Mesh::FaceHandle> faces, std::vector<Eigen::Vector2d> directions)
+{
+	unsigned edit;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		edit_faces = std::move(faces);
+		edit_directions = std::move(directions);
+		has_edit = true;
+		cancel_solve = true;
+		edit = submitted.fetch_add(1, std::memory_order_acq_rel) + 1;
+	}
+	wake.notify_one();
+	return edit;
+}
+
+bool BackgroundSolver::poll(Result &result)
+{
+	if (!(shared.load(std::memory_order_relaxed) & FRESH))
+		return false;
+
+	front = shared.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+	std::swap(result, slots[front]);
+	return true;
+}
+
+void BackgroundSolver::publish()
+{
+	back = shared.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+void BackgroundSolver::run()
+{
+	std::vector<Mesh::FaceHandle> faces;
+	std::vector<Eigen::Vector2d> directions;
+
+	for (;;)
+	{
+		unsigned edit;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]
+					  { return stopping || has_edit; });
+			if (stopping)
+				return;
+
+			// Take the latest edit; the ones before it were never started
+			std::swap(faces, edit_faces);
+			std::swap(directions, edit_directions);
+			has_edit = false;
+			cancel_solve = false;
+			edit = submitted.load(std::memory_order_acquire);
+		}
+
+		Result &result = slots[back];
+		result.edit = edit;
+		result.error.clear();
+
+		auto start = std::chrono::steady_clock::now();
+		SolveStatus status = SolveStatus::Cancelled;
+		try
+		{
+			// A newer edit (or the destructor) cancels the solve through the flag
+			SolveOptions options;
+			options.cancel = &cancel_solve;
+
+			field.set_constraints(faces, directions);
+			status = field.solve(options);
+			if (status == SolveStatus::Converged)
+				field.extract_cross_angles(result.angles);
+			else if (status == SolveStatus::NotConverged)
+				result.error = "The iterative solver did not converge";
+		}
+		catch (const std::exception &e)
+		{
+			result.error = e.what();
+		}
+
+		if (status == SolveStatus::Converged || !result.error.empty())
+		{
+			result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			result.backend = field.last_solver_backend();
+			publish();
+		}
+		solved.store(edit, std::memory_order_release);
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mesh.h"
+#include "CrossField.h"
+
+// Re-solves a Cross field on a worker thread while a viewer keeps rendering.
+//
+// Constraint edits are queued without waiting for the solver; an edit arriving
+// during a solve cancels it (at its next stage or iteration) and only the latest
+// edit is solved. Results come back through a lock-free triple buffer: the worker
+// fills one slot while the render thread reads another, and neither ever waits.
+class BackgroundSolver
+{
+public:
+	struct Result
+	{
+		std::vector<float> angles; // see CrossField::extract_cross_angles
+		unsigned edit = 0;		   // number of the edit that was solved (1 for the first)
+		double seconds = 0;		   // wall time of the solve
+		SolverBackendType backend = SolverBackendType::Auto;
+		std::string error; // empty if the solve succeeded (angles are then not set)
+	};
+
+	// The field belongs to the worker until the solver is destroyed
+	explicit BackgroundSolver(CrossField &field);
+	~BackgroundSolver();
+
+	BackgroundSolver(const BackgroundSolver &) = delete;
+	BackgroundSolver &operator=(const BackgroundSolver &) = delete;
+
+	// Returns the number of the edit
+	unsigned submit(std::vector<Mesh::FaceHandle> faces, std::vector<Eigen::Vector2d> directions);
+
+	// Swaps the newest result into result if there is one the caller has not seen
+	// yet; never blocks. Reusing the same Result avoids allocations.
+	bool poll(Result &result);
+
+	// Whether an edit is queued or being solved
+	bool busy() const { return solved.load(std::memory_order_acquire) != submitted.load(std::memory_order_acquire); }
+
+private:
+	CrossField &field;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<Mesh::FaceHandle> edit_faces;
+	std::vector<Eigen::Vector2d> edit_directions;
+	bool has_edit = false;
+	bool stopping = false;
+	std::atomic<bool> cancel_solve{false}; // SolveOptions::cancel of the running solve
+
+	std::atomic<unsigned> submitted{0}; // last edit submitted
+	std::atomic<unsigned> solved{0};	// last edit solved, cancelled or failed
+
+	// Triple buffer: the worker owns slots[back], the reader slots[front], and the
+	// third is exchanged through shared together with a flag for new data
+	static constexpr unsigned FRESH = 4;
+	Result slots[3];
+	std::atomic<unsigned> shared{1};
+	unsigned back = 0;
+	unsigned front = 2;
+
+	std::thread worker;
+
+	void run();
+	void publish();
+};
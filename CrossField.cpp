@@ -1,9 +1,49 @@
 #include "CrossField.h"
 
-CrossField::CrossField(Mesh &input_mesh)
-	: mesh(input_mesh),
-	  local_frame(mesh), e_f_conj_pow4(mesh), x_f0(mesh)
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <numeric>
+
+namespace
+{
+	// body(i) for i in [0, n), in parallel; rethrows the first exception
+	template <typename Body>
+	void parallel_for(int n, Body &&body)
+	{
+		std::exception_ptr error;
+
+#pragma omp parallel for schedule(dynamic) if (n > 1)
+		for (int i = 0; i < n; ++i)
+		{
+			try
+			{
+				body(i);
+			}
+			catch (...)
+			{
+#pragma omp critical
+				if (!error)
+					error = std::current_exception();
+			}
+		}
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
+
+CrossField::CrossField(Mesh &input_mesh, FieldType type)
+	: mesh(input_mesh), field_type(type),
+	  e_f_conj_pow4(mesh), x_f0(mesh), x_f2(mesh)
+{
+	if (field_type == FieldType::PolyVector)
+		e_f_conj_pow2.emplace(mesh);
+}
+
+CrossField::~CrossField()
 {
+	finish_pending();
 }
 
 void CrossField::set_constraints(const std::vector<Mesh::FaceHandle> &faces,
@@ -12,31 +52,186 @@ void CrossField::set_constraints(const std::vector<Mesh::FaceHandle> &faces,
 	if (faces.size() != directions.size())
 		throw std::invalid_argument("The number of faces and directions must be the same");
 
+	finish_pending();
+	constraints_faces = faces;
+	constraints_directions = to_constraint_frames(directions);
+	constraints_weights.clear();
+}
+
+void CrossField::set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+								 const std::vector<std::array<Eigen::Vector2d, 2>> &frames)
+{
+	if (faces.size() != frames.size())
+		throw std::invalid_argument("The number of faces and frames must be the same");
+
+	finish_pending();
 	constraints_faces = faces;
+	constraints_directions = to_constraint_frames(frames);
+	constraints_weights.clear();
+}
+
+void CrossField::set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+									  const std::vector<Eigen::Vector2d> &directions,
+									  const std::vector<double> &weights)
+{
+	if (faces.size() != weights.size())
+		throw std::invalid_argument("The number of faces and weights must be the same");
+	if (std::any_of(weights.begin(), weights.end(), [](double w)
+					{ return !(w > 0); }))
+		throw std::invalid_argument("Constraint weights must be positive");
+
+	set_constraints(faces, directions);
+	constraints_weights = weights;
+}
 
-	constraints_directions.resize(directions.size());
+void CrossField::set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+									  const std::vector<std::array<Eigen::Vector2d, 2>> &frames,
+									  const std::vector<double> &weights)
+{
+	if (faces.size() != weights.size())
+		throw std::invalid_argument("The number of faces and weights must be the same");
+	if (std::any_of(weights.begin(), weights.end(), [](double w)
+					{ return !(w > 0); }))
+		throw std::invalid_argument("Constraint weights must be positive");
+
+	set_constraints(faces, frames);
+	constraints_weights = weights;
+}
+
+CrossField::ConstraintFrames CrossField::to_constraint_frames(const std::vector<Eigen::Vector2d> &directions)
+{
+	ConstraintFrames constraint_frames(directions.size());
 	for (size_t i = 0; i < directions.size(); ++i)
 	{
 		auto direc = directions[i].normalized();
-		constraints_directions[i] = complexd(direc.x(), direc.y());
+		auto u = complexd(direc.x(), direc.y());
+		constraint_frames[i] = {u, complexd(0, 1) * u};
 	}
+	return constraint_frames;
+}
+
+CrossField::ConstraintFrames CrossField::to_constraint_frames(const std::vector<std::array<Eigen::Vector2d, 2>> &frames)
+{
+	ConstraintFrames constraint_frames(frames.size());
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		const auto &[u, v] = frames[i];
+		if (u.squaredNorm() == 0 || v.squaredNorm() == 0)
+			throw std::invalid_argument("Constraint frames must not contain zero vectors");
+		constraint_frames[i] = {complexd(u.x(), u.y()), complexd(v.x(), v.y())};
+	}
+	return constraint_frames;
 }
 
 void CrossField::solve()
 {
-	compute_local_frame();
-	compute_LCconnection();
-	solve_vector_field();
+	if (solve(SolveOptions()) == SolveStatus::NotConverged)
+		throw std::runtime_error("The iterative solver did not converge");
+}
+
+SolveStatus CrossField::solve(const SolveOptions &options)
+{
+	finish_pending();
+
+	SolveControl control(options);
+	return run_solve(control);
+}
+
+SolveHandle CrossField::solve_async(SolveOptions options)
+{
+	finish_pending();
+
+	auto control = std::make_shared<SolveControl>(std::move(options));
+	auto result = std::async(std::launch::async, [this, control]
+							 { return run_solve(*control); });
+
+	pending = SolveHandle(control, result.share());
+	return pending;
+}
+
+void CrossField::finish_pending()
+{
+	if (!pending.valid())
+		return;
+
+	pending.cancel();
+	pending.wait();
+	pending = SolveHandle();
+}
+
+void CrossField::wait_pending() const
+{
+	// The worker writes the field and the frames until it finishes
+	if (pending.valid())
+		pending.wait();
+}
+
+void CrossField::check_frames_ready() const
+{
+	if (!geometry_ready || !frames_ready)
+		throw std::runtime_error("The local frames must be computed (by prepare or solve) before extracting the field");
+}
+
+SolveStatus CrossField::run_solve(SolveControl &control)
+{
+	if (!geometry_ready || !frames_ready)
+	{
+		control.report(SolveStage::Geometry);
+		prepare_geometry();
+	}
+
+	SolveStatus status;
+	if (control.interrupted(status))
+		return status;
+
+	status = solve_vector_field(control);
+	control.report(SolveStage::Finished);
+	return status;
+}
+
+std::vector<std::vector<Eigen::Vector3d[4]>> CrossField::solve(const std::vector<std::vector<Eigen::Vector2d>> &direction_sets)
+{
+	std::vector<ConstraintFrames> sets;
+	sets.reserve(direction_sets.size());
+	for (const auto &directions : direction_sets)
+		sets.push_back(to_constraint_frames(directions));
+
+	return solve_vector_fields(sets);
+}
+
+std::vector<std::vector<Eigen::Vector3d[4]>> CrossField::solve(const std::vector<std::vector<std::array<Eigen::Vector2d, 2>>> &frame_sets)
+{
+	std::vector<ConstraintFrames> sets;
+	sets.reserve(frame_sets.size());
+	for (const auto &frames : frame_sets)
+		sets.push_back(to_constraint_frames(frames));
+
+	return solve_vector_fields(sets);
 }
 
 std::vector<Eigen::Vector3d[4]> CrossField::extract_cross_field()
 {
-	std::vector<Eigen::Vector3d[4]> cross_field(mesh.n_faces());
+	std::vector<Eigen::Vector3d[4]> cross_field;
+	extract_cross_field(cross_field);
+	return cross_field;
+}
+
+void CrossField::extract_cross_field(std::vector<Eigen::Vector3d[4]> &cross_field)
+{
+	wait_pending();
+	check_frames_ready();
+	workspace->fit(cross_field, mesh.n_faces());
+
+	if (field_type == FieldType::PolyVector)
+	{
+		extract_polyvector_roots(cross_field);
+		return;
+	}
 
 	for (const auto &f : mesh.faces())
 	{
-		auto u = local_frame[f].u;
-		auto v = local_frame[f].v;
+		Eigen::Vector3d u = local_frame.u.row(face_rank[f.idx()]);
+		Eigen::Vector3d v = local_frame.v.row(face_rank[f.idx()]);
 
 		double arg = std::arg(x_f0[f]) / 4;
 
@@ -46,96 +241,873 @@ std::vector<Eigen::Vector3d[4]> CrossField::extract_cross_field()
 			cross_field[f.idx()][k] = cos(angle) * u + sin(angle) * v;
 		}
 	}
+}
 
-	return cross_field;
+void CrossField::extract_local_frames(std::vector<std::array<Eigen::Vector3d, 2>> &frames) const
+{
+	wait_pending();
+	check_frames_ready();
+	frames.resize(mesh.n_faces());
+	for (int i = 0; i < mesh.n_faces(); ++i)
+		frames[face_order[i]] = {local_frame.u.row(i).transpose(), local_frame.v.row(i).transpose()};
 }
 
-void CrossField::compute_local_frame()
+void CrossField::extract_cross_angles(std::vector<float> &angles) const
 {
+	if (field_type == FieldType::PolyVector)
+		throw std::runtime_error("Only Cross fields are described by one angle per face");
+
+	wait_pending();
+	angles.resize(mesh.n_faces());
 	for (const auto &f : mesh.faces())
+		angles[f.idx()] = static_cast<float>(std::arg(x_f0[f]) / 4);
+}
+
+FieldMetrics CrossField::compute_metrics(int histogram_bins) const
+{
+	wait_pending();
+	if (!geometry_ready || !frames_ready)
+		throw std::runtime_error("The field must be solved on the current geometry before computing metrics");
+
+	const int n_faces = mesh.n_faces();
+	const int n_vertices = mesh.n_vertices();
+	FieldMetrics metrics;
+
+	// The energy of unit coefficients only measures how the crosses turn
+	auto unit = [](complexd x)
+	{
+		double r = std::abs(x);
+		return r > 0 ? x / r : complexd(0);
+	};
+
+	metrics.face_energy.resize(n_faces);
+	double total_energy = 0;
+#pragma omp parallel for schedule(static) reduction(+ : total_energy)
+	for (int i = 0; i < n_faces; ++i)
+	{
+		auto f = mesh.face_handle(i);
+		double energy = 0;
+		for (const auto &he : mesh.fh_range(f))
+			if (!he.opp().is_boundary())
+				energy += std::norm(e_f_conj_pow4[he] * unit(x_f0[f]) -
+									e_f_conj_pow4[he.opp()] * unit(x_f0[he.opp().face()]));
+		metrics.face_energy[i] = energy / 2;
+		total_energy += energy / 2;
+	}
+	metrics.total_energy = total_energy;
+	metrics.energy_histogram = Histogram::of(metrics.face_energy, histogram_bins);
+
+	// Around a vertex, the jumps of the field across the edges (in the frames of the
+	// edges) and 4 times the angle defect add up to the index in full turns of x_f0
+	metrics.vertex_index.assign(n_vertices, 0);
+	metrics.angle_defect.assign(n_vertices, 0.0);
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n_vertices; ++i)
+	{
+		auto v = mesh.vertex_handle(i);
+		if (v.is_boundary())
+			continue;
+
+		double angles = 0, jumps = 0;
+		for (const auto &he : mesh.voh_range(v))
+		{
+			Eigen::Vector3d a = mesh.point(he.to()) - mesh.point(v);
+			Eigen::Vector3d b = mesh.point(he.prev().from()) - mesh.point(v);
+			angles += std::atan2(a.cross(b).norm(), a.dot(b));
+
+			complexd from = e_f_conj_pow4[he.opp()] * x_f0[he.opp().face()];
+			complexd to = e_f_conj_pow4[he] * x_f0[he.face()];
+			jumps += std::arg(to * std::conj(from));
+		}
+
+		double defect = 2 * M_PI - angles;
+		metrics.angle_defect[i] = defect;
+		metrics.vertex_index[i] = static_cast<int>(std::lround((jumps + 4 * defect) / (2 * M_PI)));
+	}
+
+	std::vector<double> interior_defects;
+	interior_defects.reserve(n_vertices);
+	for (int i = 0; i < n_vertices; ++i)
 	{
-		auto n = mesh.calc_face_normal(f);
-		auto u = (mesh.point(f.halfedge().to()) - mesh.point(f.halfedge().from())).normalized();
-		auto v = n.cross(u);
-		local_frame[f] = {n, u, v};
+		int index = metrics.vertex_index[i];
+		metrics.n_positive_singularities += index > 0;
+		metrics.n_negative_singularities += index < 0;
+		if (!mesh.vertex_handle(i).is_boundary())
+			interior_defects.push_back(metrics.angle_defect[i]);
+	}
+	metrics.n_singularities = metrics.n_positive_singularities + metrics.n_negative_singularities;
+
+	if (!interior_defects.empty())
+	{
+		auto [min, max] = std::minmax_element(interior_defects.begin(), interior_defects.end());
+		metrics.min_angle_defect = *min;
+		metrics.max_angle_defect = *max;
+		metrics.mean_angle_defect = std::accumulate(interior_defects.begin(), interior_defects.end(), 0.0) /
+									interior_defects.size();
+	}
+	metrics.angle_defect_histogram = Histogram::of(interior_defects, histogram_bins);
+
+	const int n_constraints = constraints_faces.size();
+	metrics.constraint_deviation.resize(n_constraints);
+	for (int i = 0; i < n_constraints; ++i)
+	{
+		auto f = constraints_faces[i];
+		auto c = constraint_coefficients(constraints_directions[i]);
+
+		double deviation;
+		if (field_type == FieldType::PolyVector)
+			deviation = std::sqrt((std::norm(x_f0[f] - c[0]) + std::norm(x_f2[f] - c[1])) /
+								  (std::norm(c[0]) + std::norm(c[1])));
+		else
+			deviation = std::abs(std::arg(x_f0[f] * std::conj(c[0]))) / 4;
+
+		metrics.constraint_deviation[i] = deviation;
+		metrics.max_constraint_deviation = std::max(metrics.max_constraint_deviation, deviation);
+		metrics.mean_constraint_deviation += deviation / n_constraints;
 	}
+
+	return metrics;
 }
 
-void CrossField::compute_LCconnection()
+std::array<CrossField::complexd, 2> CrossField::constraint_coefficients(const std::array<complexd, 2> &frame) const
 {
-	for (const auto &e : mesh.edges())
+	const auto &[u, v] = frame;
+
+	if (field_type == FieldType::PolyVector)
+		// (z^2 - u^2)(z^2 - v^2) = z^4 + x_f2 z^2 + x_f0
+		return {u * u * v * v, -(u * u + v * v)};
+	else
+		// the cross {u, iu, -u, -iu} is represented by u^4
+		return {u * u * u * u, 0.0};
+}
+
+void CrossField::extract_polyvector_roots(std::vector<Eigen::Vector3d[4]> &cross_field) const
+{
+	// The roots of z^4 + x_f2 z^2 + x_f0 are {a, b, -a, -b}, where a^2 and b^2 solve
+	// w^2 + x_f2 w + x_f0 = 0. Faces are processed in fixed-size batches so that the
+	// complex arithmetic runs on packed Eigen arrays instead of one face at a time.
+	constexpr Eigen::Index batch_size = 1024;
+	const Eigen::Index n_faces = mesh.n_faces();
+
+	auto &ws = *workspace;
+	auto &c0 = ws.c0, &c2 = ws.c2, &disc = ws.disc, &a = ws.root_a, &b = ws.root_b;
+	for (auto *buffer : {&c0, &c2, &disc, &a, &b})
+		ws.fit(*buffer, batch_size, 1);
+
+	for (Eigen::Index begin = 0; begin < n_faces; begin += batch_size)
 	{
-		if (e.is_boundary())
-			continue;
+		Eigen::Index size = std::min(batch_size, n_faces - begin);
 
-		auto he = e.halfedge(0);
-		auto f = he.face(), g = he.opp().face();
+		for (Eigen::Index i = 0; i < size; ++i)
+		{
+			auto f = mesh.face_handle(face_order[begin + i]);
+			c0[i] = x_f0[f];
+			c2[i] = x_f2[f];
+		}
+
+		auto c0_b = c0.head(size), c2_b = c2.head(size);
+		auto disc_b = disc.head(size), a_b = a.head(size), b_b = b.head(size);
 
-		auto he_direc = (mesh.point(he.to()) - mesh.point(he.to())).normalized();
+		disc_b = (c2_b.square() - 4.0 * c0_b).sqrt();
+		a_b = (0.5 * (disc_b - c2_b)).sqrt();
+		b_b = (-0.5 * (disc_b + c2_b)).sqrt();
 
-		auto e_f = complexd(he_direc.dot(local_frame[f].u), he_direc.dot(local_frame[f].v));
-		auto e_g = complexd(he_direc.dot(local_frame[g].u), he_direc.dot(local_frame[g].v));
+		// keep b counter-clockwise from a
+		b_b = ((a_b.conjugate() * b_b).imag() < 0).select(-b_b, b_b);
 
-		auto e_f_conj_pow4_val = std::pow(std::conj(e_f), 4);
-		auto e_g_conj_pow4_val = std::pow(std::conj(e_g), 4);
+		for (Eigen::Index i = 0; i < size; ++i)
+		{
+			int f = face_order[begin + i];
+			Eigen::Vector3d u = local_frame.u.row(begin + i);
+			Eigen::Vector3d v = local_frame.v.row(begin + i);
+
+			Eigen::Vector3d a_3d = a_b[i].real() * u + a_b[i].imag() * v;
+			Eigen::Vector3d b_3d = b_b[i].real() * u + b_b[i].imag() * v;
 
-		e_f_conj_pow4[he] = e_f_conj_pow4_val;
-		e_f_conj_pow4[he.opp()] = e_f_conj_pow4_val;
+			cross_field[f][0] = a_3d;
+			cross_field[f][1] = b_3d;
+			cross_field[f][2] = -a_3d;
+			cross_field[f][3] = -b_3d;
+		}
 	}
 }
 
-void CrossField::solve_vector_field()
+void CrossField::prepare_geometry()
 {
-	// Construct the matrix
-	OpenMesh::FProp<bool> is_constraint_face(false, mesh);
-	for (const auto &f : constraints_faces)
-		is_constraint_face[f] = true;
+	if (!geometry_ready)
+	{
+		compute_face_order();
+		frames_ready = false;
+		geometry_ready = true;
+	}
 
-	std::vector<Eigen::Triplet<complexd>> triplet_list;
-	triplet_list.reserve(mesh.n_halfedges() * 4);
+	if (!frames_ready)
+	{
+		compute_local_frame();
+		compute_LCconnection();
+		frames_ready = true;
+		smoothest_ready.clear();
+	}
+}
 
-	for (const auto &f : mesh.faces())
+void CrossField::compute_face_order()
+{
+	compute_face_ordering(mesh, face_ordering, face_order);
+	group_components();
+
+	workspace->fit(face_rank, mesh.n_faces());
+	for (int i = 0; i < face_order.size(); ++i)
+		face_rank[face_order[i]] = i;
+}
+
+void CrossField::group_components()
+{
+	// Label the connected components in the order they first appear
+	const int n_faces = mesh.n_faces();
+	std::vector<int> component(n_faces, -1), queue;
+	queue.reserve(n_faces);
+
+	int n_components = 0;
+	for (int seed : face_order)
 	{
-		if (is_constraint_face[f])
-			// x_f0 == constraint
-			triplet_list.push_back({f.idx(), f.idx(), 1.0});
-		else
-			// x_f0 * e_f_conj_pow4 - x_g0 * e_g_conj_pow4 == 0
-			for (const auto &he : mesh.fh_range(f))
+		if (component[seed] >= 0)
+			continue;
+
+		queue.assign(1, seed);
+		component[seed] = n_components;
+		for (size_t head = 0; head < queue.size(); ++head)
+			for (const auto &he : mesh.fh_range(mesh.face_handle(queue[head])))
 			{
 				if (he.opp().is_boundary())
 					continue;
+				int g = he.opp().face().idx();
+				if (component[g] < 0)
+				{
+					component[g] = n_components;
+					queue.push_back(g);
+				}
+			}
+		++n_components;
+	}
+
+	// Make each component a contiguous range of the order (a stable counting sort),
+	// so that the system is block diagonal
+	component_begin.assign(n_components + 1, 0);
+	for (int f = 0; f < n_faces; ++f)
+		++component_begin[component[f] + 1];
+	std::partial_sum(component_begin.begin(), component_begin.end(), component_begin.begin());
+
+	if (n_components == 1)
+		return;
+
+	std::vector<int> next(component_begin.begin(), component_begin.end() - 1);
+	std::vector<int> grouped(n_faces);
+	for (int f : face_order)
+		grouped[next[component[f]]++] = f;
+	face_order.swap(grouped);
+}
+
+void CrossField::compute_local_frame()
+{
+	const int n_faces = mesh.n_faces();
+	auto &ws = *workspace;
+	auto &a = ws.a, &b = ws.b, &c = ws.c;
+	for (auto *buffer : {&a, &b, &c, &local_frame.n, &local_frame.u, &local_frame.v})
+		ws.fit(*buffer, n_faces, 3);
+
+	for (int i = 0; i < n_faces; ++i)
+	{
+		auto he = mesh.face_handle(face_order[i]).halfedge();
+		a.row(i) = mesh.point(he.from());
+		b.row(i) = mesh.point(he.to());
+		c.row(i) = mesh.point(he.next().to());
+	}
+
+	GeometryKernels::compute_local_frames(a, b, c, local_frame.n, local_frame.u, local_frame.v);
+}
+
+void CrossField::compute_LCconnection()
+{
+	// Gather the interior edges in solver order, each from the face that comes first
+	// (the orientation cancels out in the even powers)
+	auto &ws = *workspace;
+	auto &halfedges = ws.halfedges;
+
+	ws.fit(halfedges, mesh.n_edges());
+	Eigen::Index n_edges = 0;
+	for (int f : face_order)
+		for (const auto &he : mesh.fh_range(mesh.face_handle(f)))
+			if (!he.opp().is_boundary() && face_rank[he.opp().face().idx()] > face_rank[f])
+				halfedges[n_edges++] = he.idx();
+
+	auto &he_direc = ws.he_direc;
+	auto &f = ws.f, &g = ws.g;
+	ws.fit(he_direc, n_edges, 3);
+	ws.fit(f, n_edges, 1);
+	ws.fit(g, n_edges, 1);
+
+	for (Eigen::Index i = 0; i < n_edges; ++i)
+	{
+		auto he = mesh.halfedge_handle(halfedges[i]);
+		he_direc.row(i) = mesh.point(he.to()) - mesh.point(he.from());
+		f[i] = face_rank[he.face().idx()];
+		g[i] = face_rank[he.opp().face().idx()];
+	}
+
+	auto &e_f_pow2 = ws.e_f_pow2, &e_f_pow4 = ws.e_f_pow4, &e_g_pow2 = ws.e_g_pow2, &e_g_pow4 = ws.e_g_pow4;
+	for (auto *buffer : {&e_f_pow2, &e_f_pow4, &e_g_pow2, &e_g_pow4})
+		ws.fit(*buffer, n_edges, 2);
+	GeometryKernels::compute_connection(he_direc, f, g, local_frame.u, local_frame.v,
+										e_f_pow2, e_f_pow4, e_g_pow2, e_g_pow4);
+
+	// Each halfedge stores the connection in the frame of its own face
+	for (Eigen::Index i = 0; i < n_edges; ++i)
+	{
+		auto he = mesh.halfedge_handle(halfedges[i]);
+
+		e_f_conj_pow4[he] = complexd(e_f_pow4(i, 0), e_f_pow4(i, 1));
+		e_f_conj_pow4[he.opp()] = complexd(e_g_pow4(i, 0), e_g_pow4(i, 1));
+
+		if (e_f_conj_pow2)
+		{
+			(*e_f_conj_pow2)[he] = complexd(e_f_pow2(i, 0), e_f_pow2(i, 1));
+			(*e_f_conj_pow2)[he.opp()] = complexd(e_g_pow2(i, 0), e_g_pow2(i, 1));
+		}
+	}
+}
+
+void CrossField::build_system()
+{
+	// Unknowns are interleaved per face: [x_f0, x_f2] in PolyVector mode, so both
+	// coefficients are solved in one system and stay close in memory
+	const int n = n_coefficients();
+	system.resize(mesh.n_faces(), n);
 
-				auto e = he.edge();
-				auto f = he.face(), g = he.opp().face();
+	// Soft constraints only add weights to the diagonal and keep the pattern
+	for (int i = 0; i < constraints_faces.size(); ++i)
+	{
+		int f = face_rank[constraints_faces[i].idx()];
+		if (soft_constraints())
+			system.weight[f] += constraints_weights[i];
+		else
+			system.is_constraint[f] = true;
+	}
 
-				auto e_f_conj_pow4_val = e_f_conj_pow4[he];
-				auto e_g_conj_pow4_val = e_f_conj_pow4[he.opp()];
+	// x_f0 is transported by e^4 and x_f2 by e^2
+	const OpenMesh::HProp<complexd> *connection[2] = {&e_f_conj_pow4, e_f_conj_pow2 ? &*e_f_conj_pow2 : nullptr};
 
-				triplet_list.push_back({f.idx(), f.idx(), e_f_conj_pow4_val});
-				triplet_list.push_back({f.idx(), g.idx(), -e_g_conj_pow4_val});
+	// Slot of a halfedge: its face in solver order, then its place around the face
+	auto slot = [&](const auto &he)
+	{
+		int s = CrossFieldOperator::SLOTS * face_rank[he.face().idx()];
+		for (const auto &h : mesh.fh_range(he.face()))
+		{
+			if (h == he)
+				break;
+			++s;
+		}
+		return s;
+	};
+
+	for (int i = 0; i < mesh.n_faces(); ++i)
+	{
+		int s = CrossFieldOperator::SLOTS * i;
+		for (const auto &he : mesh.fh_range(mesh.face_handle(face_order[i])))
+		{
+			if (!he.opp().is_boundary())
+			{
+				system.opposite[s] = slot(he.opp());
+				for (int k = 0; k < n; ++k)
+					system.conj_pow[k][s] = (*connection[k])[he];
 			}
+			++s;
+		}
 	}
 
-	Eigen::SparseMatrix<complexd> A(mesh.n_faces(), mesh.n_faces());
-	A.setFromTriplets(triplet_list.begin(), triplet_list.end());
+	shift_unconstrained_components();
+}
+
+void CrossField::build_rhs(const ConstraintFrames &directions, Eigen::Ref<Eigen::VectorXcd> b) const
+{
+	const int n = n_coefficients();
 
-	// Construct the right-hand side
-	Eigen::VectorXcd b(mesh.n_faces());
 	b.setZero();
 	for (int i = 0; i < constraints_faces.size(); ++i)
-		b[constraints_faces[i].idx()] = constraints_directions[i];
+	{
+		auto coefficients = constraint_coefficients(directions[i]);
+		double w = soft_constraints() ? constraints_weights[i] : 1.0;
+		for (int k = 0; k < n; ++k)
+			b[n * face_rank[constraints_faces[i].idx()] + k] += w * coefficients[k];
+	}
+	system.move_constraints_to_rhs(b);
+}
 
-	// Solve the linear system
-	Eigen::ConjugateGradient<Eigen::SparseMatrix<complexd>, Eigen::Lower | Eigen::Upper> solver;
+void CrossField::shift_unconstrained_components()
+{
+	const int n_components = component_begin.size() - 1;
+
+	workspace->fit(component_constrained, n_components);
+	unconstrained_components.clear();
+	for (int c = 0; c < n_components; ++c)
+	{
+		component_constrained[c] = is_constrained(c);
+		if (!component_constrained[c])
+			unconstrained_components.push_back(c);
+	}
+
+	if (unconstrained_components.empty())
+		return;
+
+	// The shift keeps the block of a component defined when it has no holonomy and
+	// the matrix is singular
+	const int n = n_coefficients();
+	auto &diag = workspace->diagonal;
+	workspace->fit(diag, system.rows(), 1);
+	system.diagonal(diag);
+
+	for (int c : unconstrained_components)
+	{
+		int begin = component_begin[c], end = component_begin[c + 1];
+		double shift = 1e-8 * std::max(diag.segment(n * begin, n * (end - begin)).real().mean(), 1.0);
+		for (int f = begin; f < end; ++f)
+			system.weight[f] += shift;
+	}
+}
+
+void CrossField::factorize_blocks()
+{
+	const int n = n_coefficients();
+	const int n_components = component_begin.size() - 1;
+	const int threads = std::max(1, Eigen::nbThreads() / n_components);
+
+	if (!blocks_pattern_ready || system.is_constraint != factored_constraints)
+	{
+		blocks_pattern_ready = false;
+		blocks.resize(n_components);
+		for (int c = 0; c < n_components; ++c)
+		{
+			blocks[c].begin = n * component_begin[c];
+			blocks[c].size = n * (component_begin[c + 1] - component_begin[c]);
+			blocks[c].solver.reset();
+		}
+
+		// Largest blocks first, so that the small ones fill in at the end
+		blocks_by_size.resize(n_components);
+		std::iota(blocks_by_size.begin(), blocks_by_size.end(), 0);
+		std::sort(blocks_by_size.begin(), blocks_by_size.end(), [&](int c, int d)
+				  { return blocks[c].size > blocks[d].size; });
+	}
+
+	// Each block gets a backend for its size and its share of the threads
+	auto block_backend = [&](const Block &block)
+	{
+		return choose_backend(block.size, (CrossFieldOperator::SLOTS + 1) * block.size, threads);
+	};
+
+	bool same_backends = std::all_of(blocks.begin(), blocks.end(), [&](const Block &block)
+									 { return block.solver && block.solver->type() == block_backend(block); });
+	bool same_values = blocks_pattern_ready && blocks_values_ready;
+	if (same_values && same_backends && system.weight == factored_weights)
+		return;
+
+	// Only the weights (and shifts) on the diagonal have changed
+	auto &diag = workspace->diagonal;
+	if (same_values)
+	{
+		workspace->fit(diag, system.rows(), 1);
+		system.diagonal(diag);
+	}
 
-	solver.compute(A);
-	if (solver.info() != Eigen::Success)
-		throw std::runtime_error("Failed to decompose the matrix");
+	auto factorize_block = [&](int i)
+	{
+		Block &block = blocks[blocks_by_size[i]];
+		auto type = block_backend(block);
+		int first_face = block.begin / n, n_faces = block.size / n;
+
+		if (!block.solver || block.solver->type() != type)
+		{
+			system.assemble(block.A, first_face, n_faces);
+
+			block.diagonal.resize(block.size);
+			for (int col = 0; col < block.A.outerSize(); ++col)
+				for (int p = block.A.outerIndexPtr()[col]; p < block.A.outerIndexPtr()[col + 1]; ++p)
+					if (block.A.innerIndexPtr()[p] == col)
+						block.diagonal[col] = p;
+
+			block.solver = make_solver_backend(type, solver_policy.tolerance);
+			block.solver->analyze_pattern(block.A);
+		}
+		else if (!same_values)
+			// Same pattern, new geometry: only the values change
+			system.assemble(block.A, first_face, n_faces);
+		else
+			for (int r = 0; r < block.size; ++r)
+				block.A.valuePtr()[block.diagonal[r]] = diag[block.begin + r];
+
+		block.solver->factorize(block.A);
+	};
+
+	blocks_values_ready = false;
+	parallel_for(n_components, factorize_block);
+
+	factored_constraints = system.is_constraint;
+	factored_weights = system.weight;
+	blocks_pattern_ready = true;
+	blocks_values_ready = true;
+}
+
+bool CrossField::solve_blocks(const Eigen::Ref<const Eigen::MatrixXcd> &b, Eigen::Ref<Eigen::MatrixXcd> x, bool constrained)
+{
+	std::atomic<bool> converged{true};
+	auto solve_block = [&](int i)
+	{
+		int c = blocks_by_size[i];
+		if (bool(component_constrained[c]) != constrained)
+			return;
+
+		Block &block = blocks[c];
+		if (!block.solver->solve(b.middleRows(block.begin, block.size), x.middleRows(block.begin, block.size)))
+			converged = false;
+	};
+
+	parallel_for(blocks.size(), solve_block);
+	return converged;
+}
+
+SolveStatus CrossField::solve_unconstrained(Eigen::Ref<Eigen::MatrixXcd> x, bool iterative, SolveControl &control)
+{
+	SolveStatus status = SolveStatus::Converged;
+	if (unconstrained_components.empty())
+		return status;
+
+	const int n = n_coefficients();
+	const int n_components = component_begin.size() - 1;
+	auto rows = [&](int c)
+	{
+		return std::make_pair(n * component_begin[c], n * (component_begin[c + 1] - component_begin[c]));
+	};
+
+	smoothest_ready.resize(n_components, false);
+	if (smoothest_field.size() != system.rows())
+		smoothest_field.setZero(system.rows());
 
-	Eigen::VectorXcd x_f0_val = solver.solve(b);
+	bool all_ready = std::all_of(unconstrained_components.begin(), unconstrained_components.end(), [&](int c)
+								 { return smoothest_ready[c]; });
+	if (!all_ready)
+	{
+		// Without constraints the smoothest field is the eigenvector of the smallest
+		// eigenvalue, found by inverse iteration on each unconstrained component
+		auto &ws = *workspace;
+		auto &y = ws.eigen_y, &z = ws.eigen_z;
+		ws.fit(y, system.rows(), 1);
+		ws.fit(z, system.rows(), 1);
+
+		// A warm start begins from the current field
+		if (warm_start)
+			load_solution(z);
+		y.setZero();
+		for (int c : unconstrained_components)
+		{
+			auto [begin, size] = rows(c);
+			if (smoothest_ready[c])
+				continue;
+			if (warm_start && z.segment(begin, size).squaredNorm() > 0)
+				y.segment(begin, size) = z.segment(begin, size);
+			else
+				y.segment(begin, size).setOnes();
+			y.segment(begin, size).normalize();
+		}
+
+		// The components are decoupled, so one solve covers all of them. Iterative
+		// solves only need to point towards the eigenvector, not to solve exactly.
+		const double inner_tolerance = std::max(solver_policy.tolerance, 1e-6);
+		auto inverse_step = [&]
+		{
+			if (!iterative)
+			{
+				solve_blocks(y, z, false);
+				return;
+			}
+
+			// Start from y divided by its Rayleigh quotient, the solution for an exact
+			// eigenvector, so that loose inner solves are enough
+			if (matrix_free)
+				z.noalias() = system * y;
+			else
+				z.noalias() = ws.A * y;
+			for (int c : unconstrained_components)
+			{
+				auto [begin, size] = rows(c);
+				if (smoothest_ready[c])
+				{
+					z.segment(begin, size).setZero();
+					continue;
+				}
+				complexd rayleigh = y.segment(begin, size).dot(z.segment(begin, size));
+				z.segment(begin, size) = y.segment(begin, size) / rayleigh;
+			}
+			solve_iteratively(y, z, control, inner_tolerance);
+		};
+
+		bool converged = false;
+		for (int iteration = 0; iteration < 100; ++iteration)
+		{
+			inverse_step();
+
+			converged = true;
+			for (int c : unconstrained_components)
+			{
+				auto [begin, size] = rows(c);
+				if (smoothest_ready[c])
+					continue;
+				z.segment(begin, size).normalize();
+				converged = converged && 1 - std::abs(y.segment(begin, size).dot(z.segment(begin, size))) < 1e-12;
+			}
+			y.swap(z);
+
+			if (converged || control.interrupted(status))
+				break;
+		}
+
+		// Unit-length crosses on average; only a converged eigenvector is kept
+		if (!converged && status == SolveStatus::Converged)
+			status = SolveStatus::NotConverged;
+		for (int c : unconstrained_components)
+		{
+			auto [begin, size] = rows(c);
+			if (smoothest_ready[c])
+				continue;
+			smoothest_field.segment(begin, size) = y.segment(begin, size) * std::sqrt(double(size / n));
+			smoothest_ready[c] = status == SolveStatus::Converged;
+		}
+	}
+
+	for (int c : unconstrained_components)
+	{
+		auto [begin, size] = rows(c);
+		for (int k = 0; k < x.cols(); ++k)
+			x.col(k).segment(begin, size) = smoothest_field.segment(begin, size);
+	}
+	return status;
+}
+
+void CrossField::store_solution(const Eigen::Ref<const Eigen::VectorXcd> &x_val)
+{
+	const int n = n_coefficients();
+
+	for (const auto &f : mesh.faces())
+	{
+		int i = face_rank[f.idx()];
+		x_f0[f] = x_val[n * i];
+		if (field_type == FieldType::PolyVector)
+			x_f2[f] = x_val[n * i + 1];
+	}
+}
+
+void CrossField::prepare_iterative()
+{
+	auto &ws = *workspace;
+
+	auto &inv_diagonal = ws.inv_diagonal;
+	ws.fit(inv_diagonal, system.rows(), 1);
+	system.diagonal(inv_diagonal);
+	for (auto &d : inv_diagonal)
+		d = (d == 0.0) ? 1.0 : 1.0 / d;
+
+	if (!matrix_free)
+	{
+		ws.fit(ws.A, system.rows(), system.non_zeros());
+		system.assemble(ws.A);
+	}
+}
+
+SolveStatus CrossField::solve_iteratively(const Eigen::Ref<const Eigen::VectorXcd> &b, Eigen::Ref<Eigen::VectorXcd> x,
+										 SolveControl &control, double tolerance)
+{
+	auto &ws = *workspace;
+
+	const int max_iterations = 2 * system.rows();
+
+	SolveStatus status = SolveStatus::Converged;
+	auto monitor = [&](int iteration, double error)
+	{
+		control.report(SolveStage::Iteration, iteration, error);
+		return !control.interrupted(status);
+	};
+
+	ConjugateGradientResult result;
+	if (matrix_free)
+		result = conjugate_gradient(system, b, x, ws, tolerance, max_iterations, monitor);
+	else
+		result = conjugate_gradient(ws.A, b, x, ws, tolerance, max_iterations, monitor);
+
+	// An interruption takes precedence: it stops before convergence on purpose
+	if (!result.converged && status == SolveStatus::Converged)
+		status = SolveStatus::NotConverged;
+	return status;
+}
+
+bool CrossField::is_constrained(int component) const
+{
+	for (int i = component_begin[component]; i < component_begin[component + 1]; ++i)
+		if (system.is_constraint[i] || system.weight[i] > 0)
+			return true;
+	return false;
+}
+
+SolverBackendType CrossField::choose_backend(Eigen::Index unknowns, Eigen::Index non_zeros, int threads) const
+{
+	if (solver_backend != SolverBackendType::Auto)
+		return solver_backend;
+	return solver_policy.choose(unknowns, non_zeros, threads);
+}
+
+void CrossField::load_solution(Eigen::Ref<Eigen::VectorXcd> x_val) const
+{
+	const int n = n_coefficients();
 
-	// Store the solution
 	for (const auto &f : mesh.faces())
-		x_f0[f] = x_f0_val[f.idx()];
-}
\ No newline at end of file
+	{
+		int i = face_rank[f.idx()];
+		x_val[n * i] = x_f0[f];
+		if (field_type == FieldType::PolyVector)
+			x_val[n * i + 1] = x_f2[f];
+	}
+}
+
+void CrossField::copy_solution(const CrossField &other)
+{
+	if (other.mesh.n_faces() != mesh.n_faces() || other.field_type != field_type)
+		throw std::invalid_argument("Solutions can only be copied between fields of the same kind on the same connectivity");
+
+	finish_pending();
+	for (const auto &f : mesh.faces())
+	{
+		auto g = other.mesh.face_handle(f.idx());
+		x_f0[f] = other.x_f0[g];
+		x_f2[f] = other.x_f2[g];
+	}
+}
+
+SolveStatus CrossField::solve_vector_field(SolveControl &control)
+{
+	auto &ws = *workspace;
+
+	control.report(SolveStage::Assembly);
+	build_system();
+
+	// Construct the right-hand side
+	auto &b = ws.rhs;
+	ws.fit(b, system.rows(), 1);
+	build_rhs(constraints_directions, b);
+
+	SolveStatus status = SolveStatus::Converged;
+	if (control.interrupted(status))
+		return status;
+
+	// Solve the linear system
+	auto &x_val = ws.x;
+	ws.fit(x_val, system.rows(), 1);
+	auto type = matrix_free ? SolverBackendType::ConjugateGradient
+							: choose_backend(system.rows(), system.non_zeros(), Eigen::nbThreads());
+	last_backend = type;
+
+	bool iterative = type == SolverBackendType::ConjugateGradient;
+	if (iterative)
+	{
+		prepare_iterative();
+		if (warm_start)
+			load_solution(x_val);
+		else
+			x_val.setZero();
+		status = solve_iteratively(b, x_val, control, solver_policy.tolerance);
+	}
+	else
+	{
+		control.report(SolveStage::Factorization);
+		factorize_blocks();
+		last_backend = blocks[blocks_by_size[0]].solver->type();
+
+		if (!solve_blocks(b, x_val, true))
+			status = SolveStatus::NotConverged;
+	}
+
+	// Interrupted solves leave the unconstrained components as they are
+	if (status == SolveStatus::Converged || status == SolveStatus::NotConverged)
+	{
+		SolveStatus smoothest_status = solve_unconstrained(x_val, iterative, control);
+		if (smoothest_status != SolveStatus::Converged)
+			status = smoothest_status;
+	}
+
+	// A deadline keeps the last iterate, a cancelled solve leaves the field alone
+	if (status != SolveStatus::Cancelled)
+		store_solution(x_val);
+	return status;
+}
+
+std::vector<std::vector<Eigen::Vector3d[4]>> CrossField::solve_vector_fields(const std::vector<ConstraintFrames> &sets)
+{
+	for (const auto &directions : sets)
+		if (directions.size() != constraints_faces.size())
+			throw std::invalid_argument("Every constraint set must have one value per constraint face");
+
+	finish_pending();
+	prepare_geometry();
+	build_system();
+
+	auto &ws = *workspace;
+
+	// One right-hand side per column
+	auto &B = ws.rhs_block;
+	ws.fit(B, system.rows(), sets.size());
+	for (int k = 0; k < sets.size(); ++k)
+		build_rhs(sets[k], B.col(k));
+
+	// Factor once, then solve all columns in the same triangular sweeps
+	auto &X = ws.x_block;
+	ws.fit(X, system.rows(), sets.size());
+
+	// Direct backends pay off most here, as the factorization is shared by all sets
+	auto type = matrix_free ? SolverBackendType::ConjugateGradient
+							: choose_backend(system.rows(), system.non_zeros(), Eigen::nbThreads());
+	last_backend = type;
+
+	SolveControl control;
+	bool iterative = type == SolverBackendType::ConjugateGradient;
+	if (!iterative)
+	{
+		factorize_blocks();
+		last_backend = blocks[blocks_by_size[0]].solver->type();
+
+		X.setZero();
+		if (!solve_blocks(B, X, true))
+			throw std::runtime_error("The iterative solver did not converge");
+	}
+	else
+	{
+		prepare_iterative();
+		for (int k = 0; k < sets.size(); ++k)
+		{
+			if (warm_start)
+				load_solution(X.col(k));
+			else
+				X.col(k).setZero();
+			if (solve_iteratively(B.col(k), X.col(k), control, solver_policy.tolerance) == SolveStatus::NotConverged)
+				throw std::runtime_error("The iterative solver did not converge");
+		}
+	}
+
+	// Every set shares the smoothest field of the unconstrained components
+	if (solve_unconstrained(X, iterative, control) == SolveStatus::NotConverged)
+		throw std::runtime_error("The inverse iteration of an unconstrained component did not converge");
+
+	std::vector<std::vector<Eigen::Vector3d[4]>> fields(sets.size());
+	for (int k = 0; k < sets.size(); ++k)
+	{
+		store_solution(X.col(k));
+		extract_cross_field(fields[k]);
+	}
+
+	return fields;
+}
@@ -1,48 +1,284 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <complex>
+#include <memory>
+#include <optional>
 
 #include <Eigen/Sparse>
 #include <OpenMesh/Core/Utils/PropertyManager.hh>
 
 #include "Mesh.h"
+#include "GeometryKernels.h"
+#include "FaceOrdering.h"
+#include "CrossFieldOperator.h"
+#include "SolverWorkspace.h"
+#include "SolveControl.h"
+#include "SolverBackend.h"
+#include "FieldMetrics.h"
 
 class CrossField
 {
 public:
-	CrossField(Mesh &input_mesh);
+	// Cross: one coefficient per face (x_f0), orthogonal crosses of unit length
+	// PolyVector: z^4 + x_f2 z^2 + x_f0, non-orthogonal frames of any length
+	enum class FieldType
+	{
+		Cross,
+		PolyVector
+	};
+
+	CrossField(Mesh &input_mesh, FieldType type = FieldType::Cross);
+	~CrossField();
 
+	// Each direction d is expanded to the cross {d, rot90(d)}
 	void set_constraints(const std::vector<Mesh::FaceHandle> &faces,
 						 const std::vector<Eigen::Vector2d> &directions);
 
+	// Each frame {u, v} is given in the local frame of its face
+	void set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+						 const std::vector<std::array<Eigen::Vector2d, 2>> &frames);
+
+	// Soft constraints: each face is pulled towards its direction (or frame) with the
+	// given weight on top of the smoothness energy. The sparsity pattern does not
+	// depend on the constraints, so editing them only refactors numerically.
+	void set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+							  const std::vector<Eigen::Vector2d> &directions,
+							  const std::vector<double> &weights);
+	void set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+							  const std::vector<std::array<Eigen::Vector2d, 2>> &frames,
+							  const std::vector<double> &weights);
+
+	// Renumber faces in the linear system (results are still indexed by face)
+	void set_face_ordering(FaceOrdering ordering)
+	{
+		finish_pending();
+		face_ordering = ordering;
+		update_geometry();
+	}
+
+	// Frames and connection are kept between solves; call after moving vertices
+	void update_geometry()
+	{
+		finish_pending();
+		geometry_ready = false;
+		blocks_pattern_ready = false;
+	}
+
+	// Cheaper update_geometry for meshes whose connectivity has not changed (e.g. the
+	// frames of an animation): keeps the face order and the analyzed sparsity pattern
+	void update_positions()
+	{
+		finish_pending();
+		frames_ready = false;
+		blocks_values_ready = false;
+	}
+
+	// Computes frames and connection now instead of in the next solve
+	void prepare()
+	{
+		finish_pending();
+		prepare_geometry();
+	}
+
+	// Iterative solves start from the current field instead of zero
+	void set_warm_start(bool enabled)
+	{
+		finish_pending();
+		warm_start = enabled;
+	}
+
+	// Takes the field of another CrossField on a mesh with the same connectivity,
+	// e.g. as the warm start for the next frame of an animation
+	void copy_solution(const CrossField &other);
+
+	// Solve with CG on CrossFieldOperator instead of an assembled sparse matrix
+	void set_matrix_free(bool enabled)
+	{
+		finish_pending();
+		matrix_free = enabled;
+	}
+
+	// Linear solver for the assembled system; Auto picks one per solve (and per
+	// connected component) with the policy. The matrix-free mode always uses CG.
+	// Factorizations are kept between solves: new constraint values only solve
+	// again, new weights or vertex positions refactor numerically, and new geometry
+	// or hard constraint faces analyze the pattern again.
+	void set_solver_backend(SolverBackendType type)
+	{
+		finish_pending();
+		solver_backend = type;
+		blocks_pattern_ready = false;
+	}
+	void set_solver_policy(const SolverPolicy &policy)
+	{
+		finish_pending();
+		solver_policy = policy;
+		blocks_pattern_ready = false;
+	}
+	const SolverPolicy &get_solver_policy() const { return solver_policy; }
+
+	// Backend used by the last solve of the whole mesh (or its largest component)
+	SolverBackendType last_solver_backend() const { return last_backend; }
+
+	// Scratch buffers for solving; after the first solve, further solves of a mesh
+	// of the same size reuse them. Can be shared between fields solved in turn.
+	void set_workspace(std::shared_ptr<SolverWorkspace> ws)
+	{
+		finish_pending();
+		workspace = std::move(ws);
+	}
+	const std::shared_ptr<SolverWorkspace> &get_workspace() const { return workspace; }
+
+	// Connected components without any constraint get their smoothest field, scaled
+	// to unit-length crosses on average. Throws if an iterative solver, or the inverse
+	// iteration for such a component, does not converge.
 	void solve();
 
+	// Reports progress, and stops at the deadline with the last iterate (iterative
+	// solvers) or without a result (before a direct factorization). Iterative solvers
+	// that do not converge return NotConverged.
+	SolveStatus solve(const SolveOptions &options);
+
+	// Solves on a separate thread. Starting another solve, changing the constraints or
+	// geometry, or destroying the field cancels it and waits for it to stop, so a
+	// stale solve never outlives an edit.
+	SolveHandle solve_async(SolveOptions options = {});
+
+	// The extract_* functions and compute_metrics wait for a pending solve_async
+	// instead of cancelling it, and throw before the frames have been computed
+	// (by prepare or a solve).
+
+	// Solves once for each set of directions (or frames) on the faces passed to
+	// set_constraints; the system is factored once and all sets are solved together.
+	// x_f0 is left holding the last set. Throws if an iterative solver does not converge.
+	std::vector<std::vector<Eigen::Vector3d[4]>> solve(const std::vector<std::vector<Eigen::Vector2d>> &direction_sets);
+	std::vector<std::vector<Eigen::Vector3d[4]>> solve(const std::vector<std::vector<std::array<Eigen::Vector2d, 2>>> &frame_sets);
+
 	std::vector<Eigen::Vector3d[4]> extract_cross_field();
+	void extract_cross_field(std::vector<Eigen::Vector3d[4]> &cross_field);
+
+	// Compact form of a Cross field for rendering: the first direction on face f is
+	// cos(angles[f]) u + sin(angles[f]) v, where {u, v} = frames[f] only changes with
+	// the geometry
+	void extract_local_frames(std::vector<std::array<Eigen::Vector3d, 2>> &frames) const;
+	void extract_cross_angles(std::vector<float> &angles) const;
+
+	// Smoothness, constraint deviation, singularities and angle defects of the last
+	// solution, computed in parallel from the coefficients and the connection
+	FieldMetrics compute_metrics(int histogram_bins = 32) const;
 
 private:
 	using complexd = std::complex<double>;
+	using ConstraintFrames = std::vector<std::array<complexd, 2>>; // {u, v} per constraint face
 
 	Mesh &mesh;
 
+	FieldType field_type;
+
 	std::vector<Mesh::FaceHandle> constraints_faces;
-	std::vector<complexd> constraints_directions;
+	ConstraintFrames constraints_directions;
+	std::vector<double> constraints_weights; // empty for hard constraints
+
+	FaceOrdering face_ordering = FaceOrdering::None;
+	std::vector<int> face_order; // solver index -> face index
+	std::vector<int> face_rank;	 // face index -> solver index
 
-	// local frame on each face
+	// Faces of connected component c are face_order[component_begin[c] .. component_begin[c + 1])
+	std::vector<int> component_begin;
+
+	// local frame on each face, one row per solver index
 	struct LocalFrame
 	{
-		Eigen::Vector3d n; // normal
-		Eigen::Vector3d u;
-		Eigen::Vector3d v;
+		GeometryKernels::Vec3Array n; // normal
+		GeometryKernels::Vec3Array u;
+		GeometryKernels::Vec3Array v;
+	};
+
+	LocalFrame local_frame;
+
+	OpenMesh::HProp<complexd> e_f_conj_pow4;				 // LC connection
+	std::optional<OpenMesh::HProp<complexd>> e_f_conj_pow2; // LC connection for x_f2, PolyVector only
+
+	bool geometry_ready = false; // face order, frames and connection are up to date
+	bool frames_ready = false;	 // frames and connection are up to date
+
+	bool matrix_free = false;
+	bool warm_start = false;
+	CrossFieldOperator system;
+
+	SolverBackendType solver_backend = SolverBackendType::Auto;
+	SolverPolicy solver_policy;
+	SolverBackendType last_backend = SolverBackendType::Auto;
+
+	std::shared_ptr<SolverWorkspace> workspace = std::make_shared<SolverWorkspace>();
+
+	SolveHandle pending; // last solve_async
+
+	// The assembled system is factored per diagonal block, one per connected
+	// component. The pattern of a block is analyzed once per geometry, set of hard
+	// constraint faces and backend; later solves rewrite its values (its diagonal if
+	// only the weights changed) and refactor numerically, or reuse the factorization
+	// as is if the matrix has not changed.
+	struct Block
+	{
+		int begin = 0, size = 0; // rows
+		Eigen::SparseMatrix<complexd> A;
+		std::vector<int> diagonal; // position of (r, r) in A.valuePtr()
+		std::unique_ptr<SolverBackend> solver;
 	};
 
-	OpenMesh::FProp<LocalFrame> local_frame;
+	std::vector<Block> blocks;		 // per component
+	std::vector<int> blocks_by_size; // largest first
+	bool blocks_pattern_ready = false;
+	bool blocks_values_ready = false;
+	std::vector<char> factored_constraints; // system.is_constraint of the analyzed pattern
+	std::vector<double> factored_weights;	// system.weight of the factored values
 
-	OpenMesh::HProp<complexd> e_f_conj_pow4; // LC connection
+	// Components without any constraint, whose field is the smoothest one instead.
+	// It only depends on the geometry of the component, so it is kept until the
+	// frames change.
+	std::vector<char> component_constrained;
+	std::vector<int> unconstrained_components;
+	Eigen::VectorXcd smoothest_field;
+	std::vector<char> smoothest_ready; // per component
 
 	OpenMesh::FProp<complexd> x_f0;
+	OpenMesh::FProp<complexd> x_f2; // PolyVector only
+
+	int n_coefficients() const { return field_type == FieldType::PolyVector ? 2 : 1; }
+	static ConstraintFrames to_constraint_frames(const std::vector<Eigen::Vector2d> &directions);
+	static ConstraintFrames to_constraint_frames(const std::vector<std::array<Eigen::Vector2d, 2>> &frames);
 
+	bool soft_constraints() const { return !constraints_weights.empty(); }
+
+	std::array<complexd, 2> constraint_coefficients(const std::array<complexd, 2> &frame) const;
+
+	void prepare_geometry();
+	void compute_face_order();
+	void group_components();
 	void compute_local_frame();
 	void compute_LCconnection();
-	void solve_vector_field();
-};
\ No newline at end of file
+	void build_system();
+	void shift_unconstrained_components();
+	void factorize_blocks();
+	bool solve_blocks(const Eigen::Ref<const Eigen::MatrixXcd> &b, Eigen::Ref<Eigen::MatrixXcd> x, bool constrained);
+	SolveStatus solve_unconstrained(Eigen::Ref<Eigen::MatrixXcd> x, bool iterative, SolveControl &control);
+	void build_rhs(const ConstraintFrames &directions, Eigen::Ref<Eigen::VectorXcd> b) const;
+	void store_solution(const Eigen::Ref<const Eigen::VectorXcd> &x_val);
+	void load_solution(Eigen::Ref<Eigen::VectorXcd> x_val) const;
+	void finish_pending();
+	void wait_pending() const;
+	void check_frames_ready() const;
+	SolveStatus run_solve(SolveControl &control);
+	void prepare_iterative();
+	SolveStatus solve_iteratively(const Eigen::Ref<const Eigen::VectorXcd> &b, Eigen::Ref<Eigen::VectorXcd> x,
+								  SolveControl &control, double tolerance);
+	SolveStatus solve_vector_field(SolveControl &control);
+	SolverBackendType choose_backend(Eigen::Index unknowns, Eigen::Index non_zeros, int threads) const;
+	bool is_constrained(int component) const;
+	std::vector<std::vector<Eigen::Vector3d[4]>> solve_vector_fields(const std::vector<ConstraintFrames> &sets);
+
+	void extract_polyvector_roots(std::vector<Eigen::Vector3d[4]> &cross_field) const;
+};
@@ -0,0 +1,182 @@
+#include "CrossFieldOperator.h"
+
+#include <stdexcept>
+
+CrossFieldOperator::CrossFieldOperator(int n_faces, int n_coefficients)
+{
+	resize(n_faces, n_coefficients);
+}
+
+void CrossFieldOperator::resize(int n_faces, int n_coefficients)
+{
+	this->n_faces = n_faces;
+	this->n_coefficients = n_coefficients;
+
+	is_constraint.assign(n_faces, false);
+	weight.assign(n_faces, 0.0);
+	opposite.assign(SLOTS * n_faces, -1);
+	for (int k = 0; k < n_coefficients; ++k)
+		conj_pow[k].assign(SLOTS * n_faces, 0.0);
+}
+
+void CrossFieldOperator::apply(const Eigen::Ref<const Eigen::VectorXcd> &x, Eigen::Ref<Eigen::VectorXcd> y,
+							   const Scalar &alpha) const
+{
+	const int n = n_coefficients;
+
+	// Every face only writes its own rows, so faces can be processed in parallel
+#pragma omp parallel for schedule(static)
+	for (int f = 0; f < n_faces; ++f)
+		for (int k = 0; k < n; ++k)
+		{
+			int row = n * f + k;
+
+			if (is_constraint[f])
+			{
+				y[row] += alpha * x[row];
+				continue;
+			}
+
+			Scalar sum = weight[f] * x[row];
+			for (int s = SLOTS * f; s < SLOTS * (f + 1); ++s)
+			{
+				int t = opposite[s];
+				if (t < 0)
+					continue;
+
+				int g = t / SLOTS;
+				Scalar c_f = conj_pow[k][s];
+				sum += std::norm(c_f) * x[row];
+				if (!is_constraint[g])
+					sum -= std::conj(c_f) * conj_pow[k][t] * x[n * g + k];
+			}
+
+			y[row] += alpha * sum;
+		}
+}
+
+CrossFieldOperator::Scalar CrossFieldOperator::diagonal_entry(int f, int k) const
+{
+	if (is_constraint[f])
+		return 1.0;
+
+	Scalar d = weight[f];
+	for (int s = SLOTS * f; s < SLOTS * (f + 1); ++s)
+		if (opposite[s] >= 0)
+			d += std::norm(conj_pow[k][s]);
+	return d;
+}
+
+void CrossFieldOperator::diagonal(Eigen::Ref<Eigen::VectorXcd> diag) const
+{
+	const int n = n_coefficients;
+
+	for (int f = 0; f < n_faces; ++f)
+		for (int k = 0; k < n; ++k)
+			diag[n * f + k] = diagonal_entry(f, k);
+}
+
+void CrossFieldOperator::move_constraints_to_rhs(Eigen::Ref<Eigen::VectorXcd> b) const
+{
+	const int n = n_coefficients;
+
+	for (int f = 0; f < n_faces; ++f)
+	{
+		if (is_constraint[f])
+			continue;
+
+		for (int s = SLOTS * f; s < SLOTS * (f + 1); ++s)
+		{
+			int g = neighbour(s);
+			if (g < 0 || !is_constraint[g])
+				continue;
+
+			for (int k = 0; k < n; ++k)
+				b[n * f + k] += std::conj(conj_pow[k][s]) * conj_pow[k][opposite[s]] * b[n * g + k];
+		}
+	}
+}
+
+void CrossFieldOperator::assemble(Eigen::SparseMatrix<Scalar> &A) const
+{
+	assemble(A, 0, n_faces);
+}
+
+void CrossFieldOperator::assemble(Eigen::SparseMatrix<Scalar> &A, int first_face, int count) const
+{
+	const int n = n_coefficients;
+	const int size = n * count;
+
+	// resize() keeps the value and index arrays, resizeNonZeros() only grows them
+	A.resize(size, size);
+	A.resizeNonZeros((SLOTS + 1) * size);
+
+	Scalar *values = A.valuePtr();
+	int *inner = A.innerIndexPtr();
+	int *outer = A.outerIndexPtr();
+
+	// The matrix is Hermitian, so column n f + k is the conjugate of row n f + k
+	int nnz = 0;
+	for (int f = first_face; f < first_face + count; ++f)
+		for (int k = 0; k < n; ++k)
+		{
+			int col = n * (f - first_face) + k;
+			int begin = nnz;
+			outer[col] = begin;
+
+			inner[nnz] = col;
+			values[nnz++] = diagonal_entry(f, k);
+
+			if (!is_constraint[f])
+				for (int s = SLOTS * f; s < SLOTS * (f + 1); ++s)
+				{
+					int g = neighbour(s);
+					if (g < 0 || is_constraint[g])
+						continue;
+					if (g < first_face || g >= first_face + count)
+						throw std::logic_error("The block is coupled to faces outside of it");
+
+					int row = n * (g - first_face) + k;
+					Scalar value = -conj_pow[k][s] * std::conj(conj_pow[k][opposite[s]]);
+
+					// Insertion into the (at most SLOTS + 1) sorted entries of the column
+					int p = nnz;
+					while (p > begin && inner[p - 1] > row)
+						--p;
+
+					if (p > begin && inner[p - 1] == row)
+					{
+						values[p - 1] += value;
+						continue;
+					}
+
+					for (int q = nnz; q > p; --q)
+					{
+						inner[q] = inner[q - 1];
+						values[q] = values[q - 1];
+					}
+					inner[p] = row;
+					values[p] = value;
+					++nnz;
+				}
+		}
+
+	outer[size] = nnz;
+	A.resizeNonZeros(nnz);
+}
+
+Eigen::SparseMatrix<CrossFieldOperator::Scalar> CrossFieldOperator::to_sparse() const
+{
+	Eigen::SparseMatrix<Scalar> A;
+	assemble(A);
+	return A;
+}
+
+CrossFieldPreconditioner &CrossFieldPreconditioner::factorize(const CrossFieldOperator &A)
+{
+	inv_diagonal.resize(A.rows());
+	A.diagonal(inv_diagonal);
+	for (auto &d : inv_diagonal)
+		d = (d == 0.0) ? 1.0 : 1.0 / d;
+	return *this;
+}
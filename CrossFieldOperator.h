@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+
+#include <Eigen/Sparse>
+
+class CrossFieldOperator;
+
+namespace Eigen
+{
+	namespace internal
+	{
+		// CrossFieldOperator looks like a sparse matrix to Eigen's iterative solvers
+		template <>
+		struct traits<CrossFieldOperator> : public traits<SparseMatrix<std::complex<double>>>
+		{
+		};
+	}
+}
+
+// Smoothness system of the cross field on faces in solver order, stored as one
+// connection value per halfedge plus the slot of its opposite halfedge.
+//
+// Row of an unconstrained face f, for coefficient k with connection c = conj(e)^p:
+//     sum_g |c_f|^2 x_f - conj(c_f) c_g x_g
+// (the gradient of sum_g |c_f x_f - c_g x_g|^2), with the terms of constrained
+// neighbours moved to the right-hand side; constrained faces have identity rows.
+// Soft constraints add weight_f to the diagonal instead and leave the pattern alone.
+// The system is Hermitian and can either be applied directly (matrix-free) or
+// assembled into a sparse matrix.
+class CrossFieldOperator : public Eigen::EigenBase<CrossFieldOperator>
+{
+public:
+	using Scalar = std::complex<double>;
+	using RealScalar = double;
+	using StorageIndex = int;
+	enum
+	{
+		ColsAtCompileTime = Eigen::Dynamic,
+		MaxColsAtCompileTime = Eigen::Dynamic,
+		IsRowMajor = false
+	};
+
+	static constexpr int SLOTS = 3; // halfedges per face
+
+	CrossFieldOperator() = default;
+	CrossFieldOperator(int n_faces, int n_coefficients);
+
+	void resize(int n_faces, int n_coefficients);
+
+	Index rows() const { return n_faces * n_coefficients; }
+	Index cols() const { return rows(); }
+
+	int n_faces = 0;
+	int n_coefficients = 1;
+
+	// Unknowns are interleaved per face: n_coefficients * face + k
+	std::vector<char> is_constraint; // per face
+	std::vector<double> weight;		 // per face, soft constraints
+	std::vector<int> opposite;		 // per slot, the slot of the opposite halfedge; -1 across boundaries
+	std::vector<Scalar> conj_pow[2]; // per slot, for each coefficient, in the frame of the face
+
+	// Face across slot s, -1 across boundaries
+	int neighbour(int s) const { return opposite[s] < 0 ? -1 : opposite[s] / SLOTS; }
+
+	template <typename Rhs>
+	Eigen::Product<CrossFieldOperator, Rhs, Eigen::AliasFreeProduct> operator*(const Eigen::MatrixBase<Rhs> &x) const
+	{
+		return Eigen::Product<CrossFieldOperator, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+	}
+
+	// y += alpha * A x
+	void apply(const Eigen::Ref<const Eigen::VectorXcd> &x, Eigen::Ref<Eigen::VectorXcd> y,
+			   const Scalar &alpha) const;
+
+	// diag must have rows() entries
+	void diagonal(Eigen::Ref<Eigen::VectorXcd> diag) const;
+
+	// b holds the constraint values at constrained unknowns and zero elsewhere;
+	// adds the contributions of constrained neighbours to the other rows
+	void move_constraints_to_rhs(Eigen::Ref<Eigen::VectorXcd> b) const;
+
+	// Upper bound on the stored entries of the assembled matrix
+	Eigen::Index non_zeros() const { return (SLOTS + 1) * rows(); }
+
+	// Writes the compressed matrix into A, reusing its storage when it is large enough;
+	// diagonal entries are always stored, so the pattern only depends on the constraints
+	void assemble(Eigen::SparseMatrix<Scalar> &A) const;
+
+	// Diagonal block of faces [first_face, first_face + count), which must not be
+	// coupled to any other face (e.g. a connected component)
+	void assemble(Eigen::SparseMatrix<Scalar> &A, int first_face, int count) const;
+	Eigen::SparseMatrix<Scalar> to_sparse() const;
+
+private:
+	Scalar diagonal_entry(int f, int k) const;
+};
+
+// Jacobi preconditioner for CrossFieldOperator
+class CrossFieldPreconditioner
+{
+public:
+	CrossFieldPreconditioner() = default;
+
+	CrossFieldPreconditioner &analyzePattern(const CrossFieldOperator &) { return *this; }
+	CrossFieldPreconditioner &factorize(const CrossFieldOperator &A);
+	CrossFieldPreconditioner &compute(const CrossFieldOperator &A) { return factorize(A); }
+
+	template <typename Rhs>
+	Eigen::VectorXcd solve(const Eigen::MatrixBase<Rhs> &b) const { return inv_diagonal.asDiagonal() * b; }
+
+	Eigen::ComputationInfo info() const { return Eigen::Success; }
+
+private:
+	Eigen::VectorXcd inv_diagonal;
+};
+
+namespace Eigen
+{
+	namespace internal
+	{
+		template <typename Rhs>
+		struct generic_product_impl<CrossFieldOperator, Rhs, SparseShape, DenseShape, GemvProduct>
+			: generic_product_impl_base<CrossFieldOperator, Rhs, generic_product_impl<CrossFieldOperator, Rhs>>
+		{
+			using Scalar = typename Product<CrossFieldOperator, Rhs>::Scalar;
+
+			template <typename Dest>
+			static void scaleAndAddTo(Dest &dst, const CrossFieldOperator &lhs, const Rhs &rhs, const Scalar &alpha)
+			{
+				lhs.apply(rhs, dst, alpha);
+			}
+		};
+	}
+}
@@ -0,0 +1,105 @@
+#include "CrossFieldSequence.h"
+
+#include <future>
+
+CrossFieldSequence::CrossFieldSequence(const Mesh &mesh, FieldType type)
+	: meshes{mesh, mesh}
+{
+	for (int k = 0; k < 2; ++k)
+	{
+		fields[k] = std::make_unique<CrossField>(meshes[k], type);
+		fields[k]->set_warm_start(true);
+	}
+}
+
+void CrossFieldSequence::set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+										 const std::vector<Eigen::Vector2d> &directions)
+{
+	for (auto &field : fields)
+		field->set_constraints(faces, directions);
+}
+
+void CrossFieldSequence::set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+										 const std::vector<std::array<Eigen::Vector2d, 2>> &frames)
+{
+	for (auto &field : fields)
+		field->set_constraints(faces, frames);
+}
+
+void CrossFieldSequence::set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+											  const std::vector<Eigen::Vector2d> &directions,
+											  const std::vector<double> &weights)
+{
+	for (auto &field : fields)
+		field->set_soft_constraints(faces, directions, weights);
+}
+
+void CrossFieldSequence::set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+											  const std::vector<std::array<Eigen::Vector2d, 2>> &frames,
+											  const std::vector<double> &weights)
+{
+	for (auto &field : fields)
+		field->set_soft_constraints(faces, frames, weights);
+}
+
+void CrossFieldSequence::set_face_ordering(FaceOrdering ordering)
+{
+	for (auto &field : fields)
+		field->set_face_ordering(ordering);
+}
+
+void CrossFieldSequence::set_matrix_free(bool enabled)
+{
+	for (auto &field : fields)
+		field->set_matrix_free(enabled);
+}
+
+void CrossFieldSequence::set_positions(int k, const Positions &positions)
+{
+	if (positions.size() != meshes[k].n_vertices())
+		throw std::invalid_argument("Every frame must have one position per vertex");
+
+	for (const auto &v : meshes[k].vertices())
+		meshes[k].set_point(v, positions[v.idx()]);
+
+	fields[k]->update_positions();
+	fields[k]->prepare();
+}
+
+void CrossFieldSequence::solve(const std::vector<Positions> &frames, const FrameCallback &on_frame)
+{
+	if (frames.empty())
+		return;
+
+	set_positions(0, frames[0]);
+
+	for (int i = 0; i < frames.size(); ++i)
+	{
+		int current = i % 2, next = 1 - current;
+
+		// Preprocess the next frame while this one is solved
+		std::future<void> preprocessing;
+		if (i + 1 < frames.size())
+			preprocessing = std::async(std::launch::async, [this, next, &frames, i]
+									   { set_positions(next, frames[i + 1]); });
+
+		try
+		{
+			fields[current]->solve();
+			fields[current]->extract_cross_field(cross_field);
+			on_frame(i, cross_field);
+		}
+		catch (...)
+		{
+			if (preprocessing.valid())
+				preprocessing.wait();
+			throw;
+		}
+
+		if (preprocessing.valid())
+		{
+			preprocessing.get();
+			fields[next]->copy_solution(*fields[current]);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <functional>
+#include <memory>
+
+#include "Mesh.h"
+#include "CrossField.h"
+
+// Cross fields for the frames of an animation with fixed connectivity.
+//
+// Two CrossFields on two copies of the mesh are used in turn: while one solves
+// frame i, the other computes the local frames and connection of frame i + 1 on a
+// second thread. Both keep their face order and analyzed sparsity pattern for the
+// whole sequence, and each frame starts from the field of the previous one.
+class CrossFieldSequence
+{
+public:
+	using FieldType = CrossField::FieldType;
+
+	// Positions of all vertices, indexed like the vertices of the mesh
+	using Positions = std::vector<Eigen::Vector3d>;
+
+	using FrameCallback = std::function<void(int frame, const std::vector<Eigen::Vector3d[4]> &cross_field)>;
+
+	CrossFieldSequence(const Mesh &mesh, FieldType type = FieldType::Cross);
+
+	CrossFieldSequence(const CrossFieldSequence &) = delete;
+	CrossFieldSequence &operator=(const CrossFieldSequence &) = delete;
+
+	void set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+						 const std::vector<Eigen::Vector2d> &directions);
+	void set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+						 const std::vector<std::array<Eigen::Vector2d, 2>> &frames);
+	void set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+							  const std::vector<Eigen::Vector2d> &directions,
+							  const std::vector<double> &weights);
+	void set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+							  const std::vector<std::array<Eigen::Vector2d, 2>> &frames,
+							  const std::vector<double> &weights);
+
+	void set_face_ordering(FaceOrdering ordering);
+	void set_matrix_free(bool enabled);
+
+	// Solves every frame in order; on_frame is called on the calling thread with the
+	// field of each frame, which is only valid during the call
+	void solve(const std::vector<Positions> &frames, const FrameCallback &on_frame);
+
+private:
+	Mesh meshes[2];
+	std::unique_ptr<CrossField> fields[2];
+	std::vector<Eigen::Vector3d[4]> cross_field;
+
+	void set_positions(int k, const Positions &positions);
+};
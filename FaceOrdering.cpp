@@ -0,0 +1,205 @@
+#include "FaceOrdering.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+	// Faces adjacent through interior edges, -1 for boundary edges
+	std::vector<std::array<int, 3>> face_neighbours(const Mesh &mesh)
+	{
+		std::vector<std::array<int, 3>> neighbours(mesh.n_faces(), {-1, -1, -1});
+		for (const auto &f : mesh.faces())
+		{
+			int k = 0;
+			for (const auto &he : mesh.fh_range(f))
+				if (!he.opp().is_boundary() && k < 3)
+					neighbours[f.idx()][k++] = he.opp().face().idx();
+		}
+		return neighbours;
+	}
+
+	int degree(const std::array<int, 3> &neighbours)
+	{
+		return std::count_if(neighbours.begin(), neighbours.end(), [](int g)
+							 { return g >= 0; });
+	}
+
+	// Breadth-first levels from start; returns the faces of the last level
+	std::vector<int> last_level(const std::vector<std::array<int, 3>> &neighbours,
+								int start, std::vector<int> &level, int &depth)
+	{
+		std::vector<int> visited{start}, frontier{start}, next;
+		level[start] = 0;
+		depth = 0;
+
+		while (true)
+		{
+			next.clear();
+			for (int f : frontier)
+				for (int g : neighbours[f])
+					if (g >= 0 && level[g] < 0)
+					{
+						level[g] = depth + 1;
+						visited.push_back(g);
+						next.push_back(g);
+					}
+
+			if (next.empty())
+				break;
+
+			frontier.swap(next);
+			++depth;
+		}
+
+		for (int f : visited)
+			level[f] = -1;
+
+		return frontier;
+	}
+
+	// George-Liu heuristic: start of a long breadth-first traversal
+	int pseudo_peripheral_face(const std::vector<std::array<int, 3>> &neighbours,
+							   int start, std::vector<int> &level)
+	{
+		int depth = 0;
+		auto frontier = last_level(neighbours, start, level, depth);
+
+		while (true)
+		{
+			int candidate = *std::min_element(frontier.begin(), frontier.end(), [&](int f, int g)
+											  { return degree(neighbours[f]) < degree(neighbours[g]); });
+
+			int candidate_depth = 0;
+			auto candidate_frontier = last_level(neighbours, candidate, level, candidate_depth);
+			if (candidate_depth <= depth)
+				return start;
+
+			start = candidate;
+			depth = candidate_depth;
+			frontier.swap(candidate_frontier);
+		}
+	}
+
+	std::vector<int> reverse_cuthill_mckee(const Mesh &mesh)
+	{
+		const int n_faces = mesh.n_faces();
+		auto neighbours = face_neighbours(mesh);
+
+		std::vector<int> order;
+		order.reserve(n_faces);
+
+		std::vector<bool> placed(n_faces, false);
+		std::vector<int> level(n_faces, -1);
+
+		// Faces by increasing degree, so each component starts from a low-degree face
+		std::vector<int> by_degree(n_faces);
+		std::iota(by_degree.begin(), by_degree.end(), 0);
+		std::stable_sort(by_degree.begin(), by_degree.end(), [&](int f, int g)
+						 { return degree(neighbours[f]) < degree(neighbours[g]); });
+
+		for (int seed : by_degree)
+		{
+			if (placed[seed])
+				continue;
+
+			int start = pseudo_peripheral_face(neighbours, seed, level);
+
+			// Cuthill-McKee: breadth-first, visiting neighbours by increasing degree
+			size_t head = order.size();
+			order.push_back(start);
+			placed[start] = true;
+
+			while (head < order.size())
+			{
+				int f = order[head++];
+
+				std::array<int, 3> next = neighbours[f];
+				std::sort(next.begin(), next.end(), [&](int g, int h)
+						  { return (g < 0 ? 4 : degree(neighbours[g])) < (h < 0 ? 4 : degree(neighbours[h])); });
+
+				for (int g : next)
+					if (g >= 0 && !placed[g])
+					{
+						placed[g] = true;
+						order.push_back(g);
+					}
+			}
+		}
+
+		std::reverse(order.begin(), order.end());
+		return order;
+	}
+
+	// Spreads the lower 21 bits of x so that there are two zero bits between each
+	uint64_t spread_bits(uint64_t x)
+	{
+		x &= 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffff;
+		x = (x | x << 16) & 0x1f0000ff0000ff;
+		x = (x | x << 8) & 0x100f00f00f00f00f;
+		x = (x | x << 4) & 0x10c30c30c30c30c3;
+		x = (x | x << 2) & 0x1249249249249249;
+		return x;
+	}
+
+	std::vector<int> morton(const Mesh &mesh)
+	{
+		const int n_faces = mesh.n_faces();
+
+		std::vector<Eigen::Vector3d> centroid(n_faces);
+		Eigen::Vector3d min = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+		Eigen::Vector3d max = -min;
+
+		for (const auto &f : mesh.faces())
+		{
+			Eigen::Vector3d c = Eigen::Vector3d::Zero();
+			for (const auto &v : mesh.fv_range(f))
+				c += mesh.point(v);
+			c /= 3.0;
+
+			centroid[f.idx()] = c;
+			min = min.cwiseMin(c);
+			max = max.cwiseMax(c);
+		}
+
+		// Quantize to 21 bits per axis on a cube around the bounding box
+		double extent = std::max((max - min).maxCoeff(), std::numeric_limits<double>::min());
+		double scale = ((1 << 21) - 1) / extent;
+
+		std::vector<uint64_t> code(n_faces);
+		for (int i = 0; i < n_faces; ++i)
+		{
+			Eigen::Vector3d q = (centroid[i] - min) * scale;
+			code[i] = spread_bits(static_cast<uint64_t>(q.x())) |
+					  spread_bits(static_cast<uint64_t>(q.y())) << 1 |
+					  spread_bits(static_cast<uint64_t>(q.z())) << 2;
+		}
+
+		std::vector<int> order(n_faces);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](int f, int g)
+						 { return code[f] < code[g]; });
+		return order;
+	}
+}
+
+void compute_face_ordering(const Mesh &mesh, FaceOrdering ordering, std::vector<int> &order)
+{
+	switch (ordering)
+	{
+	case FaceOrdering::ReverseCuthillMcKee:
+		order = reverse_cuthill_mckee(mesh);
+		break;
+	case FaceOrdering::Morton:
+		order = morton(mesh);
+		break;
+	default:
+		order.resize(mesh.n_faces());
+		std::iota(order.begin(), order.end(), 0);
+		break;
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+
+#include "Mesh.h"
+
+// Renumbering of faces for the linear system. Faces from an OBJ file come in file
+// order, which can scatter neighbouring faces far apart in the matrix; both orders
+// below place neighbours close together to cut bandwidth, fill-in and cache misses.
+enum class FaceOrdering
+{
+	None,
+	ReverseCuthillMcKee, // breadth-first on the face adjacency graph
+	Morton				 // Z-order curve through the face centroids
+};
+
+// Fills order[i] = index of the face placed at position i
+void compute_face_ordering(const Mesh &mesh, FaceOrdering ordering, std::vector<int> &order);
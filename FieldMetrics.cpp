@@ -0,0 +1,30 @@
+#include "FieldMetrics.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+Histogram Histogram::of(const std::vector<double> &values, int bins)
+{
+	if (bins < 1)
+		throw std::invalid_argument("A histogram needs at least one bin");
+
+	Histogram histogram;
+	if (values.empty())
+		return histogram;
+
+	auto [min, max] = std::minmax_element(values.begin(), values.end());
+	histogram.lower = *min;
+	histogram.upper = *max;
+	if (histogram.upper == histogram.lower)
+		bins = 1;
+	histogram.counts.assign(bins, 0);
+
+	double scale = bins / std::max(histogram.upper - histogram.lower, 1e-300);
+	for (double value : values)
+	{
+		int bin = static_cast<int>((value - histogram.lower) * scale);
+		++histogram.counts[std::clamp(bin, 0, bins - 1)];
+	}
+
+	return histogram;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+// Counts of values in bins of equal width over [lower, upper]
+struct Histogram
+{
+	double lower = 0;
+	double upper = 0;
+	std::vector<int> counts;
+
+	// bins over the range of values (one bin if all values are equal)
+	static Histogram of(const std::vector<double> &values, int bins);
+
+	double bin_width() const { return counts.empty() ? 0 : (upper - lower) / counts.size(); }
+};
+
+// Quality of a solved field, see CrossField::compute_metrics
+struct FieldMetrics
+{
+	// Smoothness: for each interior edge, |c_f x_f - c_g x_g|^2 of the unit
+	// coefficients transported to the edge (0 for parallel crosses, at most 4),
+	// split evenly between the two faces. Indexed by face.
+	std::vector<double> face_energy;
+	double total_energy = 0;
+	Histogram energy_histogram;
+
+	// Cross: angle between the solved cross and the constraint, in [0, pi/4].
+	// PolyVector: distance of the coefficients, relative to those of the constraint.
+	// Indexed like the constraint faces.
+	std::vector<double> constraint_deviation;
+	double max_constraint_deviation = 0;
+	double mean_constraint_deviation = 0;
+
+	// Index of the field around each interior vertex in quarter turns (0 on boundary
+	// vertices); Gauss-Bonnet makes the indices of a closed mesh sum to 4 * chi
+	std::vector<int> vertex_index;
+	int n_singularities = 0;
+	int n_positive_singularities = 0;
+	int n_negative_singularities = 0;
+
+	// 2 pi minus the angles around each interior vertex (0 on boundary vertices)
+	std::vector<double> angle_defect;
+	double min_angle_defect = 0;
+	double max_angle_defect = 0;
+	double mean_angle_defect = 0; // over interior vertices
+	Histogram angle_defect_histogram;
+};
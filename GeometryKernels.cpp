@@ -0,0 +1,142 @@
+#include "GeometryKernels.h"
+
+namespace
+{
+	using GeometryKernels::ComplexArray;
+	using GeometryKernels::Vec3Array;
+
+	template <int W>
+	using Batch = Eigen::Array<double, W, 1>;
+
+	// 1 / |x|, or 0 for zero-length vectors (same as Eigen's normalized())
+	template <int W>
+	Batch<W> inverse_norm(const Batch<W> &x, const Batch<W> &y, const Batch<W> &z)
+	{
+		Batch<W> length = (x * x + y * y + z * z).sqrt();
+		return (length > 0).select(length.inverse(), Batch<W>::Zero());
+	}
+
+	template <int W>
+	void local_frames_batch(Eigen::Index i,
+							const Vec3Array &a, const Vec3Array &b, const Vec3Array &c,
+							Vec3Array &n, Vec3Array &u, Vec3Array &v)
+	{
+		Batch<W> ab_x = b.col(0).segment<W>(i) - a.col(0).segment<W>(i);
+		Batch<W> ab_y = b.col(1).segment<W>(i) - a.col(1).segment<W>(i);
+		Batch<W> ab_z = b.col(2).segment<W>(i) - a.col(2).segment<W>(i);
+
+		Batch<W> ac_x = c.col(0).segment<W>(i) - a.col(0).segment<W>(i);
+		Batch<W> ac_y = c.col(1).segment<W>(i) - a.col(1).segment<W>(i);
+		Batch<W> ac_z = c.col(2).segment<W>(i) - a.col(2).segment<W>(i);
+
+		// normal
+		Batch<W> n_x = ab_y * ac_z - ab_z * ac_y;
+		Batch<W> n_y = ab_z * ac_x - ab_x * ac_z;
+		Batch<W> n_z = ab_x * ac_y - ab_y * ac_x;
+		Batch<W> inv_n = inverse_norm<W>(n_x, n_y, n_z);
+		n_x *= inv_n;
+		n_y *= inv_n;
+		n_z *= inv_n;
+
+		// first edge
+		Batch<W> inv_u = inverse_norm<W>(ab_x, ab_y, ab_z);
+		Batch<W> u_x = ab_x * inv_u;
+		Batch<W> u_y = ab_y * inv_u;
+		Batch<W> u_z = ab_z * inv_u;
+
+		n.col(0).segment<W>(i) = n_x;
+		n.col(1).segment<W>(i) = n_y;
+		n.col(2).segment<W>(i) = n_z;
+
+		u.col(0).segment<W>(i) = u_x;
+		u.col(1).segment<W>(i) = u_y;
+		u.col(2).segment<W>(i) = u_z;
+
+		v.col(0).segment<W>(i) = n_y * u_z - n_z * u_y;
+		v.col(1).segment<W>(i) = n_z * u_x - n_x * u_z;
+		v.col(2).segment<W>(i) = n_x * u_y - n_y * u_x;
+	}
+
+	// conj(d.u + i d.v)^2 and ^4 for the frames of faces idx[i..i+W)
+	template <int W>
+	void connection_batch(Eigen::Index i,
+						  const Batch<W> &d_x, const Batch<W> &d_y, const Batch<W> &d_z,
+						  const Eigen::ArrayXi &idx, const Vec3Array &u, const Vec3Array &v,
+						  ComplexArray &conj_pow2, ComplexArray &conj_pow4)
+	{
+		Batch<W> u_x, u_y, u_z, v_x, v_y, v_z;
+		for (int k = 0; k < W; ++k)
+		{
+			int face = idx[i + k];
+			u_x[k] = u(face, 0), u_y[k] = u(face, 1), u_z[k] = u(face, 2);
+			v_x[k] = v(face, 0), v_y[k] = v(face, 1), v_z[k] = v(face, 2);
+		}
+
+		Batch<W> re = d_x * u_x + d_y * u_y + d_z * u_z;
+		Batch<W> im = -(d_x * v_x + d_y * v_y + d_z * v_z);
+
+		Batch<W> re2 = re * re - im * im;
+		Batch<W> im2 = 2.0 * re * im;
+
+		conj_pow2.col(0).segment<W>(i) = re2;
+		conj_pow2.col(1).segment<W>(i) = im2;
+
+		conj_pow4.col(0).segment<W>(i) = re2 * re2 - im2 * im2;
+		conj_pow4.col(1).segment<W>(i) = 2.0 * re2 * im2;
+	}
+
+	template <int W>
+	void connection_batch(Eigen::Index i, const Vec3Array &d,
+						  const Eigen::ArrayXi &f, const Eigen::ArrayXi &g,
+						  const Vec3Array &u, const Vec3Array &v,
+						  ComplexArray &e_f_conj_pow2, ComplexArray &e_f_conj_pow4,
+						  ComplexArray &e_g_conj_pow2, ComplexArray &e_g_conj_pow4)
+	{
+		Batch<W> d_x = d.col(0).segment<W>(i);
+		Batch<W> d_y = d.col(1).segment<W>(i);
+		Batch<W> d_z = d.col(2).segment<W>(i);
+		Batch<W> inv_d = inverse_norm<W>(d_x, d_y, d_z);
+		d_x *= inv_d;
+		d_y *= inv_d;
+		d_z *= inv_d;
+
+		connection_batch<W>(i, d_x, d_y, d_z, f, u, v, e_f_conj_pow2, e_f_conj_pow4);
+		connection_batch<W>(i, d_x, d_y, d_z, g, u, v, e_g_conj_pow2, e_g_conj_pow4);
+	}
+}
+
+void GeometryKernels::compute_local_frames(const Vec3Array &a, const Vec3Array &b, const Vec3Array &c,
+										   Vec3Array &n, Vec3Array &u, Vec3Array &v)
+{
+	const Eigen::Index size = a.rows();
+	n.resize(size, 3);
+	u.resize(size, 3);
+	v.resize(size, 3);
+
+	Eigen::Index i = 0;
+	for (; i + SIMD_WIDTH <= size; i += SIMD_WIDTH)
+		local_frames_batch<SIMD_WIDTH>(i, a, b, c, n, u, v);
+	for (; i < size; ++i)
+		local_frames_batch<1>(i, a, b, c, n, u, v);
+}
+
+void GeometryKernels::compute_connection(const Vec3Array &d,
+										 const Eigen::ArrayXi &f, const Eigen::ArrayXi &g,
+										 const Vec3Array &u, const Vec3Array &v,
+										 ComplexArray &e_f_conj_pow2, ComplexArray &e_f_conj_pow4,
+										 ComplexArray &e_g_conj_pow2, ComplexArray &e_g_conj_pow4)
+{
+	const Eigen::Index size = d.rows();
+	e_f_conj_pow2.resize(size, 2);
+	e_f_conj_pow4.resize(size, 2);
+	e_g_conj_pow2.resize(size, 2);
+	e_g_conj_pow4.resize(size, 2);
+
+	Eigen::Index i = 0;
+	for (; i + SIMD_WIDTH <= size; i += SIMD_WIDTH)
+		connection_batch<SIMD_WIDTH>(i, d, f, g, u, v,
+									 e_f_conj_pow2, e_f_conj_pow4, e_g_conj_pow2, e_g_conj_pow4);
+	for (; i < size; ++i)
+		connection_batch<1>(i, d, f, g, u, v,
+							e_f_conj_pow2, e_f_conj_pow4, e_g_conj_pow2, e_g_conj_pow4);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+// Batched geometry kernels over structure-of-arrays inputs.
+// Elements are processed SIMD_WIDTH at a time on fixed-size Eigen arrays, which
+// Eigen maps onto AVX-512 / AVX / SSE registers; the tail (and builds without
+// vectorization) goes through the same code one element at a time.
+namespace GeometryKernels
+{
+#if defined(EIGEN_VECTORIZE_AVX512)
+	constexpr int SIMD_WIDTH = 8;
+#elif defined(EIGEN_VECTORIZE_AVX)
+	constexpr int SIMD_WIDTH = 4;
+#elif defined(EIGEN_VECTORIZE)
+	constexpr int SIMD_WIDTH = 2;
+#else
+	constexpr int SIMD_WIDTH = 1;
+#endif
+
+	// One 3D vector per row, each coordinate stored contiguously
+	using Vec3Array = Eigen::Array<double, Eigen::Dynamic, 3>;
+
+	// One complex number per row, columns are real and imaginary parts
+	using ComplexArray = Eigen::Array<double, Eigen::Dynamic, 2>;
+
+	// Local frames of triangles (a, b, c):
+	// n = normalize((b - a) x (c - a)), u = normalize(b - a), v = n x u
+	void compute_local_frames(const Vec3Array &a, const Vec3Array &b, const Vec3Array &c,
+							  Vec3Array &n, Vec3Array &u, Vec3Array &v);
+
+	// Levi-Civita connection across edges with direction d between faces f[i] and g[i]:
+	// e_f = (d.u_f, d.v_f) and e_g = (d.u_g, d.v_g), returned as conj(e)^2 and conj(e)^4
+	void compute_connection(const Vec3Array &d,
+							const Eigen::ArrayXi &f, const Eigen::ArrayXi &g,
+							const Vec3Array &u, const Vec3Array &v,
+							ComplexArray &e_f_conj_pow2, ComplexArray &e_f_conj_pow4,
+							ComplexArray &e_g_conj_pow2, ComplexArray &e_g_conj_pow4);
+}
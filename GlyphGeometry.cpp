@@ -0,0 +1,104 @@
+#include "GlyphGeometry.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+	std::tuple<double, Eigen::Vector3d>
+	incircle(const Eigen::Vector3d &A,
+			 const Eigen::Vector3d &B,
+			 const Eigen::Vector3d &C)
+	{
+		// Compute the lengths of the sides of the triangle
+		double a = (B - C).norm();
+		double b = (A - C).norm();
+		double c = (A - B).norm();
+
+		// Compute the semi-perimeter of the triangle
+		double s = (a + b + c) / 2.0;
+
+		// Compute the area of the triangle using Heron's formula
+		double area = std::sqrt(s * (s - a) * (s - b) * (s - c));
+
+		// Compute the radius of the incircle
+		double radius = area / s;
+
+		// Compute the incenter coordinates
+		Eigen::Vector3d incenter = (a * A + b * B + c * C) / (a + b + c);
+
+		return {radius, incenter};
+	}
+
+	std::tuple<double, Eigen::Vector3d> face_incircle(const Mesh &mesh, Mesh::FaceHandle f)
+	{
+		auto he = mesh.face_handle(f.idx()).halfedge();
+		return incircle(mesh.point(he.from()), mesh.point(he.to()), mesh.point(he.next().to()));
+	}
+
+	glm::vec3 to_glm(const Eigen::Vector3d &v)
+	{
+		return {v.x(), v.y(), v.z()};
+	}
+
+	MyGL::GlyphFrame glyph_frame(const Mesh &mesh,
+								 const std::vector<std::array<Eigen::Vector3d, 2>> &local_frames,
+								 float arm_length,
+								 Mesh::FaceHandle f)
+	{
+		Eigen::Vector3d center = std::get<1>(face_incircle(mesh, f));
+		const auto &[u, v] = local_frames[f.idx()];
+		return {to_glm(center),
+				MyGL::CrossGlyphs::pack_direction(to_glm(u)),
+				MyGL::CrossGlyphs::pack_direction(to_glm(v)),
+				arm_length};
+	}
+
+	void check_frames(const Mesh &mesh, const std::vector<std::array<Eigen::Vector3d, 2>> &local_frames)
+	{
+		if (local_frames.size() != mesh.n_faces())
+			throw std::invalid_argument("There must be one local frame per face");
+	}
+}
+
+double glyph_arm_length(const Mesh &mesh, double scale)
+{
+	int n_faces = static_cast<int>(mesh.n_faces());
+	if (n_faces == 0)
+		return 0;
+
+	double total_radius = 0;
+#pragma omp parallel for schedule(static) reduction(+ : total_radius)
+	for (int i = 0; i < n_faces; i++)
+		total_radius += std::get<0>(face_incircle(mesh, mesh.face_handle(i)));
+
+	return scale * total_radius / n_faces;
+}
+
+void build_glyph_frames(const Mesh &mesh,
+						const std::vector<std::array<Eigen::Vector3d, 2>> &local_frames,
+						float arm_length,
+						MyGL::GlyphFrame *frames)
+{
+	check_frames(mesh, local_frames);
+
+	int n_faces = static_cast<int>(mesh.n_faces());
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n_faces; i++)
+		frames[i] = glyph_frame(mesh, local_frames, arm_length, mesh.face_handle(i));
+}
+
+void update_glyph_frames(const Mesh &mesh,
+						 const std::vector<std::array<Eigen::Vector3d, 2>> &local_frames,
+						 float arm_length,
+						 const std::vector<Mesh::FaceHandle> &faces,
+						 MyGL::GlyphFrame *frames)
+{
+	check_frames(mesh, local_frames);
+
+	int n_faces = static_cast<int>(faces.size());
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n_faces; i++)
+		frames[faces[i].idx()] = glyph_frame(mesh, local_frames, arm_length, faces[i]);
+}
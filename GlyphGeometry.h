@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "Mesh.h"
+#include "MyGL/CrossGlyphs.h"
+
+// Frames of the cross glyphs of a mesh (MyGL::CrossGlyphs): one glyph per face at
+// the center of its incircle, along the local frame of CrossField::extract_local_frames.
+// Faces are processed in parallel. The output is only written, so it may be a mapped
+// GPU buffer as well as memory of the caller: CrossGlyphs::map_frames for
+// build_glyph_frames, CrossGlyphs::map_frame_range for update_glyph_frames, which
+// keeps the frames it does not write.
+
+// scale times the mean incircle radius of the faces
+double glyph_arm_length(const Mesh &mesh, double scale = 0.5);
+
+// frames[f] for every face f
+void build_glyph_frames(const Mesh &mesh,
+						const std::vector<std::array<Eigen::Vector3d, 2>> &local_frames,
+						float arm_length,
+						MyGL::GlyphFrame *frames);
+
+// frames[f] for the given faces only, e.g. after they moved; the others are untouched.
+// frames is indexed by face, e.g. CrossGlyphs::map_frame_range(0, n_faces).
+void update_glyph_frames(const Mesh &mesh,
+						 const std::vector<std::array<Eigen::Vector3d, 2>> &local_frames,
+						 float arm_length,
+						 const std::vector<Mesh::FaceHandle> &faces,
+						 MyGL::GlyphFrame *frames);
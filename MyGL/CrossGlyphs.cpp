@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "CrossGlyphs.h"
+
+MyGL::CrossGlyphs::CrossGlyphs(Span<GlyphFrame> frames, GLenum usage)
+	: usage(usage), count(static_cast<GLsizei>(frames.size()))
+{
+	setup();
+	set_frames(frames);
+}
+
+MyGL::CrossGlyphs::~CrossGlyphs()
+{
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &frame_VBO);
+}
+
+void MyGL::CrossGlyphs::set_frames(Span<GlyphFrame> frames)
+{
+	// The angle buffer is reallocated only if the number of glyphs grows
+	if (frames.size() != static_cast<size_t>(count))
+	{
+		count = static_cast<GLsizei>(frames.size());
+		reset_angles();
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, frame_VBO);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(GlyphFrame), frames.data(), usage);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+MyGL::GlyphFrame *MyGL::CrossGlyphs::map_frames(size_t count)
+{
+	if (count != static_cast<size_t>(this->count))
+	{
+		this->count = static_cast<GLsizei>(count);
+		reset_angles();
+	}
+	if (count == 0)
+		return nullptr;
+
+	glBindBuffer(GL_ARRAY_BUFFER, frame_VBO);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(GlyphFrame), nullptr, usage);
+	void *frames = glMapBufferRange(GL_ARRAY_BUFFER, 0, count * sizeof(GlyphFrame),
+									GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (!frames)
+		throw std::runtime_error("Failed to map glyph frames");
+	frames_mapped = true;
+	return static_cast<GlyphFrame *>(frames);
+}
+
+MyGL::GlyphFrame *MyGL::CrossGlyphs::map_frame_range(size_t first, size_t count)
+{
+	if (first + count > static_cast<size_t>(this->count))
+		throw std::out_of_range("Glyph frame range out of bounds");
+	if (count == 0)
+		return nullptr;
+
+	glBindBuffer(GL_ARRAY_BUFFER, frame_VBO);
+	void *frames = glMapBufferRange(GL_ARRAY_BUFFER, first * sizeof(GlyphFrame), count * sizeof(GlyphFrame),
+									GL_MAP_WRITE_BIT);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (!frames)
+		throw std::runtime_error("Failed to map glyph frames");
+	frames_mapped = true;
+	return static_cast<GlyphFrame *>(frames);
+}
+
+void MyGL::CrossGlyphs::unmap_frames()
+{
+	if (!frames_mapped)
+		return;
+	frames_mapped = false;
+
+	glBindBuffer(GL_ARRAY_BUFFER, frame_VBO);
+	GLboolean intact = glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The contents can be lost, e.g. on a display mode change
+	if (!intact)
+		throw std::runtime_error("Glyph frames were lost while mapped");
+}
+
+void MyGL::CrossGlyphs::set_angles(Span<float> angles)
+{
+	if (angles.size() != static_cast<size_t>(count))
+		throw std::invalid_argument("There must be one angle per glyph");
+
+	GLintptr offset = angle_buffer.write(angles.data(), angles.size_bytes());
+
+	// Angle, from the region just written
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, angle_buffer.get_ID());
+	glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void *)offset);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MyGL::CrossGlyphs::draw()
+{
+	glBindVertexArray(VAO);
+	glDrawArraysInstanced(GL_LINES, 0, 2 * LINES_PER_GLYPH, count);
+	glBindVertexArray(0);
+	angle_buffer.fence();
+}
+
+GLuint MyGL::CrossGlyphs::pack_direction(const glm::vec3 &direction)
+{
+	auto component = [](float x)
+	{
+		return static_cast<GLuint>(std::lround(std::clamp(x, -1.0f, 1.0f) * 511.0f)) & 0x3FF;
+	};
+	return component(direction.x) | component(direction.y) << 10 | component(direction.z) << 20;
+}
+
+void MyGL::CrossGlyphs::reset_angles()
+{
+	if (angle_buffer.get_region_size() < static_cast<GLsizeiptr>(count * sizeof(float)))
+		angle_buffer.resize(count * sizeof(float));
+	set_angles(std::vector<float>(count, 0.0f));
+}
+
+void MyGL::CrossGlyphs::setup()
+{
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &frame_VBO);
+
+	glBindVertexArray(VAO);
+
+	// Angle (pointed at a region of the stream buffer by set_angles)
+	glEnableVertexAttribArray(4);
+	glVertexAttribDivisor(4, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, frame_VBO);
+
+	// Center
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GlyphFrame), (void *)offsetof(GlyphFrame, center));
+	glVertexAttribDivisor(0, 1);
+	// Tangent directions
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(GlyphFrame), (void *)offsetof(GlyphFrame, u));
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(GlyphFrame), (void *)offsetof(GlyphFrame, v));
+	glVertexAttribDivisor(2, 1);
+	// Scale
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(GlyphFrame), (void *)offsetof(GlyphFrame, scale));
+	glVertexAttribDivisor(3, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	reset_angles();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Span.h"
+#include "StreamBuffer.h"
+
+namespace MyGL
+{
+	// Static part of the glyph of one face
+	struct GlyphFrame
+	{
+		glm::vec3 center;
+		GLuint u; // tangent directions, packed with pack_direction
+		GLuint v;
+		float scale; // length of the arms
+	};
+
+	// Cross glyphs drawn with one instance per face: the vertex shader
+	// (data/shaders/glyph.vert) expands each instance into four lines from the center
+	// along cos(a + k pi/2) u + sin(a + k pi/2) v. The frames only change with the
+	// geometry; a new field only uploads one angle per face, into a stream buffer so
+	// that it does not wait for the draws of the previous field.
+	class CrossGlyphs
+	{
+	public:
+		// Angles start at zero. usage is the glBufferData hint for the frames, e.g.
+		// GL_STREAM_DRAW for a selection that changes with the view (GlyphLOD).
+		CrossGlyphs(Span<GlyphFrame> frames, GLenum usage = GL_STATIC_DRAW);
+
+		~CrossGlyphs();
+
+		// Resets the angles if the number of glyphs changes
+		void set_frames(Span<GlyphFrame> frames);
+		void set_angles(Span<float> angles);
+
+		// Like set_frames, but the count frames are written by the caller into the
+		// returned (write-only) buffer, between these calls and before any draw. The
+		// previous frames are discarded.
+		GlyphFrame *map_frames(size_t count);
+
+		// Maps frames [first, first + count) of the current ones for a partial update,
+		// ending with unmap_frames; the frames outside the range are kept. The buffer
+		// is not orphaned, so this waits for draws that still read it.
+		GlyphFrame *map_frame_range(size_t first, size_t count);
+
+		void unmap_frames();
+
+		void draw();
+
+		// Lines drawn by the last draw(), LINES_PER_GLYPH per glyph
+		GLsizei get_n_drawn_lines() const { return LINES_PER_GLYPH * count; }
+
+		// Unit vector as a normalized GL_INT_2_10_10_10_REV
+		static GLuint pack_direction(const glm::vec3 &direction);
+
+	private:
+		static constexpr GLsizei LINES_PER_GLYPH = 4;
+
+		GLuint VAO, frame_VBO;
+		StreamBuffer angle_buffer;
+
+		GLenum usage;
+		GLsizei count;
+		bool frames_mapped = false;
+
+		void reset_angles();
+		void setup();
+	};
+}
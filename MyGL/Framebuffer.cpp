@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "Framebuffer.h"
+
+MyGL::Framebuffer::Framebuffer(int width, int height)
+	: width(0), height(0)
+{
+	glGenFramebuffers(1, &FBO);
+	glGenRenderbuffers(1, &color_RBO);
+	glGenRenderbuffers(1, &depth_RBO);
+
+	resize(width, height);
+}
+
+MyGL::Framebuffer::~Framebuffer()
+{
+	glDeleteFramebuffers(1, &FBO);
+	glDeleteRenderbuffers(1, &color_RBO);
+	glDeleteRenderbuffers(1, &depth_RBO);
+}
+
+void MyGL::Framebuffer::resize(int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		throw std::invalid_argument("Framebuffer size must be positive");
+
+	if (width == this->width && height == this->height)
+		return;
+	this->width = width;
+	this->height = height;
+
+	glBindRenderbuffer(GL_RENDERBUFFER, color_RBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth_RBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_RBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_RBO);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+		throw std::runtime_error("Incomplete framebuffer");
+}
+
+void MyGL::Framebuffer::bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glViewport(0, 0, width, height);
+}
+
+void MyGL::Framebuffer::unbind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void MyGL::Framebuffer::read_pixels(std::vector<unsigned char> &pixels) const
+{
+	const size_t row_size = 3 * static_cast<size_t>(width);
+	pixels.resize(row_size * height);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	// OpenGL returns the bottom row first
+	for (int y = 0; y < height / 2; ++y)
+		std::swap_ranges(pixels.begin() + y * row_size, pixels.begin() + (y + 1) * row_size,
+						 pixels.begin() + (height - 1 - y) * row_size);
+}
+
+void MyGL::Framebuffer::save_ppm(const std::string &file_path) const
+{
+	read_pixels(pixels);
+
+	std::ofstream file(file_path, std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open file: " + file_path);
+
+	file << "P6\n"
+		 << width << " " << height << "\n255\n";
+	file.write(reinterpret_cast<const char *>(pixels.data()), pixels.size());
+	if (!file)
+		throw std::runtime_error("Failed to write file: " + file_path);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace MyGL
+{
+	// Color and depth render target, e.g. for an OffscreenContext
+	class Framebuffer
+	{
+	public:
+		Framebuffer(int width, int height);
+		~Framebuffer();
+
+		Framebuffer(const Framebuffer &) = delete;
+		Framebuffer &operator=(const Framebuffer &) = delete;
+
+		int get_width() const { return width; }
+		int get_height() const { return height; }
+
+		// Keeps the objects, only reallocates the storage
+		void resize(int width, int height);
+
+		// Binds the framebuffer and sets the viewport to its size
+		void bind() const;
+		static void unbind();
+
+		// RGB, top row first
+		void read_pixels(std::vector<unsigned char> &pixels) const;
+
+		// Binary PPM (P6)
+		void save_ppm(const std::string &file_path) const;
+
+	private:
+		GLuint FBO, color_RBO, depth_RBO;
+
+		int width, height;
+
+		mutable std::vector<unsigned char> pixels; // reused by save_ppm
+	};
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace MyGL
+{
+	// Planes of the view volume of projection * view, pointing inwards
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+
+		explicit Frustum(const glm::mat4 &view_projection)
+		{
+			auto row = [&](int i)
+			{
+				return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+			};
+			for (int i = 0; i < 3; i++)
+			{
+				planes[2 * i] = row(3) + row(i);
+				planes[2 * i + 1] = row(3) - row(i);
+			}
+			for (auto &plane : planes)
+				plane /= glm::length(glm::vec3(plane));
+		}
+
+		// Conservative: a box near a corner of the frustum may be reported as visible
+		bool intersects_box(const glm::vec3 &lower, const glm::vec3 &upper) const
+		{
+			for (const auto &plane : planes)
+			{
+				// corner furthest along the normal
+				glm::vec3 corner(plane.x > 0 ? upper.x : lower.x,
+								 plane.y > 0 ? upper.y : lower.y,
+								 plane.z > 0 ? upper.z : lower.z);
+				if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+					return false;
+			}
+			return true;
+		}
+
+		bool contains_box(const glm::vec3 &lower, const glm::vec3 &upper) const
+		{
+			for (const auto &plane : planes)
+			{
+				// corner furthest against the normal
+				glm::vec3 corner(plane.x > 0 ? lower.x : upper.x,
+								 plane.y > 0 ? lower.y : upper.y,
+								 plane.z > 0 ? lower.z : upper.z);
+				if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+					return false;
+			}
+			return true;
+		}
+	};
+}
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "GlyphLOD.h"
+#include "Frustum.h"
+
+namespace
+{
+	// Arm length of a representative glyph, relative to the size of its node
+	const float REPRESENTATIVE_SCALE = 0.4f;
+}
+
+MyGL::GlyphLOD::GlyphLOD(Span<glm::vec3> centers, int leaf_size)
+	: order(centers.size())
+{
+	if (leaf_size < 1)
+		throw std::invalid_argument("Leaves must hold at least one glyph");
+	if (centers.empty())
+		return;
+
+	std::iota(order.begin(), order.end(), 0);
+	nodes.reserve(2 * centers.size() / leaf_size + 1);
+	build(centers, 0, static_cast<GLuint>(centers.size()), leaf_size);
+}
+
+GLuint MyGL::GlyphLOD::build(Span<glm::vec3> centers, GLuint begin, GLuint end, int leaf_size)
+{
+	GLuint index = static_cast<GLuint>(nodes.size());
+	nodes.push_back({});
+
+	glm::vec3 lower = centers[order[begin]], upper = lower;
+	for (GLuint i = begin + 1; i < end; i++)
+	{
+		lower = glm::min(lower, centers[order[i]]);
+		upper = glm::max(upper, centers[order[i]]);
+	}
+
+	glm::vec3 middle = 0.5f * (lower + upper);
+	GLuint representative = order[begin];
+	float nearest = glm::dot(centers[representative] - middle, centers[representative] - middle);
+	for (GLuint i = begin + 1; i < end; i++)
+	{
+		float distance = glm::dot(centers[order[i]] - middle, centers[order[i]] - middle);
+		if (distance < nearest)
+		{
+			nearest = distance;
+			representative = order[i];
+		}
+	}
+
+	GLuint left = 0, right = 0;
+	if (end - begin > static_cast<GLuint>(leaf_size))
+	{
+		// Median split along the longest side
+		glm::vec3 size = upper - lower;
+		int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+		GLuint half = begin + (end - begin) / 2;
+		std::nth_element(order.begin() + begin, order.begin() + half, order.begin() + end,
+						 [&](GLuint a, GLuint b)
+						 { return centers[a][axis] < centers[b][axis]; });
+
+		left = build(centers, begin, half, leaf_size);
+		right = build(centers, half, end, leaf_size);
+	}
+
+	nodes[index] = {lower, upper, begin, end, left, right, representative};
+	return index;
+}
+
+bool MyGL::GlyphLOD::select(const glm::mat4 &view, const glm::mat4 &projection, int viewport_height, float spacing)
+{
+	previous_selection.swap(selection);
+	selection.clear();
+	selection_extent.clear();
+	if (nodes.empty())
+		return !previous_selection.empty();
+
+	Frustum frustum(projection * view);
+	glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+
+	// Pixels per world unit at distance one (perspective) or anywhere (orthographic)
+	bool orthographic = projection[3][3] == 1.0f;
+	float focal = 0.5f * viewport_height * projection[1][1];
+
+	// Nodes with a flag for boxes inside the frustum, whose children need no test
+	stack.assign(1, {0, false});
+	while (!stack.empty())
+	{
+		auto [index, inside] = stack.back();
+		const Node &node = nodes[index];
+		stack.pop_back();
+
+		if (!inside)
+		{
+			if (!frustum.intersects_box(node.lower, node.upper))
+				continue;
+			inside = frustum.contains_box(node.lower, node.upper);
+		}
+
+		glm::vec3 size = node.upper - node.lower;
+		float extent = std::max(size.x, std::max(size.y, size.z));
+		float distance = glm::length(0.5f * (node.lower + node.upper) - eye) - 0.5f * glm::length(size);
+		bool small_enough = orthographic ? extent * focal <= spacing
+										 : distance > 0 && extent * focal <= spacing * distance;
+
+		if (small_enough)
+		{
+			selection.push_back(node.representative);
+			selection_extent.push_back(extent);
+		}
+		else if (node.left != 0)
+		{
+			stack.push_back({node.right, inside});
+			stack.push_back({node.left, inside});
+		}
+		else
+		{
+			selection.insert(selection.end(), order.begin() + node.begin, order.begin() + node.end);
+			selection_extent.resize(selection.size(), 0.0f);
+		}
+	}
+
+	return selection != previous_selection;
+}
+
+void MyGL::GlyphLOD::gather(Span<GlyphFrame> frames, Span<float> angles,
+							 std::vector<GlyphFrame> &selected_frames, std::vector<float> &selected_angles) const
+{
+	if (frames.size() != order.size() || angles.size() != order.size())
+		throw std::invalid_argument("There must be one frame and one angle per glyph");
+
+	selected_frames.resize(selection.size());
+	selected_angles.resize(selection.size());
+	for (size_t i = 0; i < selection.size(); i++)
+	{
+		selected_frames[i] = frames[selection[i]];
+		selected_frames[i].scale = std::max(selected_frames[i].scale, REPRESENTATIVE_SCALE * selection_extent[i]);
+		selected_angles[i] = angles[selection[i]];
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Span.h"
+#include "CrossGlyphs.h"
+
+namespace MyGL
+{
+	// Picks the glyphs to draw so that their density stays roughly constant on screen.
+	//
+	// A k-d tree over the glyph centers gives every node a representative glyph (the
+	// one nearest to the middle of its box). A view selects, for each visible node, the
+	// representative as soon as the node spans at most the requested spacing in pixels,
+	// and all glyphs of leaves that are still larger. The number of glyphs drawn is then
+	// bounded by the viewport area instead of the number of faces.
+	class GlyphLOD
+	{
+	public:
+		GlyphLOD(Span<glm::vec3> centers, int leaf_size = 8);
+
+		// Returns whether the selection changed. viewport_height is in pixels.
+		bool select(const glm::mat4 &view, const glm::mat4 &projection, int viewport_height, float spacing);
+
+		// Indices of the selected glyphs
+		const std::vector<GLuint> &get_selection() const { return selection; }
+
+		// Frames and angles of the selected glyphs, out of those of all glyphs;
+		// representatives get arms long enough to stand for their node
+		void gather(Span<GlyphFrame> frames, Span<float> angles,
+					std::vector<GlyphFrame> &selected_frames, std::vector<float> &selected_angles) const;
+
+	private:
+		struct Node
+		{
+			glm::vec3 lower, upper;
+			GLuint begin, end;		  // range of order
+			GLuint left = 0, right = 0; // children, 0 for a leaf
+			GLuint representative;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<GLuint> order; // glyph indices, contiguous for each node
+
+		std::vector<GLuint> selection;
+		std::vector<GLuint> previous_selection;
+		std::vector<float> selection_extent; // box size of the node of a representative, 0 for leaf glyphs
+
+		std::vector<std::pair<GLuint, bool>> stack; // reused by select
+		GLuint build(Span<glm::vec3> centers, GLuint begin, GLuint end, int leaf_size);
+	};
+}
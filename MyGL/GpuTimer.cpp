@@ -0,0 +1,67 @@
+#include <stdexcept>
+
+#include "GpuTimer.h"
+
+MyGL::GpuTimer::GpuTimer(int n_passes, int latency)
+	: n_passes(n_passes), latency(latency),
+	  queries(n_passes * latency), issued_in(n_passes * latency, 0),
+	  milliseconds(n_passes, 0.0)
+{
+	if (n_passes < 1 || latency < 2)
+		throw std::invalid_argument("A GPU timer needs at least one pass and a latency of two frames");
+
+	glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+MyGL::GpuTimer::~GpuTimer()
+{
+	glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+void MyGL::GpuTimer::begin_frame()
+{
+	// Newest frame whose queries have all finished; older sets are about to be reused
+	for (unsigned long f = frame; f > result_frame && f + latency > frame; f--)
+	{
+		bool issued = false, complete = true;
+		for (int pass = 0; pass < n_passes && complete; pass++)
+		{
+			size_t i = index(f, pass);
+			if (issued_in[i] != f)
+				continue;
+			GLint available = 0;
+			glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+			issued = true;
+			complete = available != 0;
+		}
+		if (!issued || !complete)
+			continue;
+
+		for (int pass = 0; pass < n_passes; pass++)
+		{
+			size_t i = index(f, pass);
+			GLuint64 nanoseconds = 0;
+			if (issued_in[i] == f)
+				glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &nanoseconds);
+			milliseconds[pass] = nanoseconds * 1e-6;
+		}
+		result_frame = f;
+		break;
+	}
+
+	frame++;
+}
+
+void MyGL::GpuTimer::begin(int pass)
+{
+	if (frame == 0)
+		throw std::logic_error("GpuTimer::begin_frame was not called");
+
+	glBeginQuery(GL_TIME_ELAPSED, queries[index(frame, pass)]);
+	issued_in[index(frame, pass)] = frame;
+}
+
+void MyGL::GpuTimer::end()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+}
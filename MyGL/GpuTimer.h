@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace MyGL
+{
+	// GL_TIME_ELAPSED queries for a fixed number of passes per frame. Each frame uses
+	// its own set of queries out of a ring of `latency` sets, and results are only
+	// read once available, so timing never stalls the pipeline; they arrive a few
+	// frames late (see get_result_frame).
+	class GpuTimer
+	{
+	public:
+		GpuTimer(int n_passes, int latency = 4);
+		~GpuTimer();
+
+		GpuTimer(const GpuTimer &) = delete;
+		GpuTimer &operator=(const GpuTimer &) = delete;
+
+		// Collects the results of earlier frames and moves to the next set of queries
+		void begin_frame();
+
+		// Passes cannot nest (one GL_TIME_ELAPSED query at a time)
+		void begin(int pass);
+		void end();
+
+		// Frame (counted by begin_frame, from 1) of the newest complete results, 0 if none yet
+		unsigned long get_result_frame() const { return result_frame; }
+		// Time of the pass in that frame, 0 if it was not issued
+		double get_milliseconds(int pass) const { return milliseconds[pass]; }
+
+	private:
+		int n_passes;
+		int latency;
+
+		std::vector<GLuint> queries;		  // latency sets of n_passes
+		std::vector<unsigned long> issued_in; // frame each query was last issued in, 0 if none
+
+		unsigned long frame = 0;
+		unsigned long result_frame = 0;
+		std::vector<double> milliseconds;
+
+		size_t index(unsigned long frame, int pass) const { return (frame % latency) * n_passes + pass; }
+	};
+}
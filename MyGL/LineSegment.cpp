@@ -1,10 +1,13 @@
+#include <stdexcept>
+
 #include "LineSegment.h"
 
-MyGL::LineSegment::LineSegment(const std::vector<glm::vec3> &vertices,
-							   const std::vector<GLuint> &indices)
-	: vertices(vertices), indices(indices)
+MyGL::LineSegment::LineSegment(Span<glm::vec3> vertices,
+							   Span<GLuint> indices,
+							   GLenum usage)
+	: n_vertices(vertices.size()), n_indices(static_cast<GLsizei>(indices.size()))
 {
-	setup();
+	setup(vertices, indices, usage);
 }
 
 MyGL::LineSegment::~LineSegment()
@@ -14,14 +17,24 @@ MyGL::LineSegment::~LineSegment()
 	glDeleteBuffers(1, &EBO);
 }
 
+void MyGL::LineSegment::update_vertices(Span<glm::vec3> vertices, size_t first)
+{
+	if (first + vertices.size() > n_vertices)
+		throw std::out_of_range("Vertex range outside of the line segments");
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::vec3), vertices.size_bytes(), vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void MyGL::LineSegment::draw()
 {
 	glBindVertexArray(VAO);
-	glDrawElements(GL_LINES, indices.size(), GL_UNSIGNED_INT, 0);
+	glDrawElements(GL_LINES, n_indices, GL_UNSIGNED_INT, 0);
 	glBindVertexArray(0);
 }
 
-void MyGL::LineSegment::setup()
+void MyGL::LineSegment::setup(Span<glm::vec3> vertices, Span<GLuint> indices, GLenum usage)
 {
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
@@ -30,14 +43,14 @@ void MyGL::LineSegment::setup()
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(), usage);
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(), GL_STATIC_DRAW);
 
 	// Position
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
 
 	glBindVertexArray(0);
-}
\ No newline at end of file
+}
@@ -7,26 +7,31 @@
 #include <glm/glm.hpp>
 
 #include "Shader.h"
+#include "Span.h"
 
 namespace MyGL
 {
 	class LineSegment
 	{
 	public:
-		LineSegment(const std::vector<glm::vec3> &vertices,
-					const std::vector<GLuint> &indices);
+		LineSegment(Span<glm::vec3> vertices,
+					Span<GLuint> indices,
+					GLenum usage = GL_STATIC_DRAW);
 
 		~LineSegment();
 
+		// Overwrites vertices [first, first + vertices.size()) in place
+		void update_vertices(Span<glm::vec3> vertices, size_t first = 0);
+
 		void draw();
 		void draw_wireframe();
 
 	private:
 		GLuint VAO, VBO, EBO;
 
-		std::vector<glm::vec3> vertices;
-		std::vector<GLuint> indices;
+		size_t n_vertices;
+		GLsizei n_indices;
 
-		void setup();
+		void setup(Span<glm::vec3> vertices, Span<GLuint> indices, GLenum usage);
 	};
-}
\ No newline at end of file
+}
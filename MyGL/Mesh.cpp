@@ -1,21 +1,93 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
 #include "Mesh.h"
 
-MyGL::Mesh::Mesh(const std::vector<Vertex> &vertices,
-				 const std::vector<GLuint> &indices)
-	: vertices(vertices), indices(indices)
+namespace
 {
-	setup();
+	// x on the grid lower + k step, as the number of steps from origin (in steps)
+	GLushort quantize(float x, float lower, float step, float origin)
+	{
+		long steps = std::lround((x - lower) / step) - std::lround(origin);
+		return static_cast<GLushort>(std::clamp(steps, 0L, 65535L));
+	}
+
+	// Unit vector to the octahedron, unfolded onto [-1, 1]^2, as two snorm16
+	void encode_octahedral(const glm::vec3 &normal, GLshort encoded[2])
+	{
+		float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		float x = l1 > 0.0f ? normal.x / l1 : 0.0f;
+		float y = l1 > 0.0f ? normal.y / l1 : 0.0f;
+		if (normal.z < 0.0f)
+		{
+			float folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float folded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = folded_x;
+			y = folded_y;
+		}
+		encoded[0] = static_cast<GLshort>(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+		encoded[1] = static_cast<GLshort>(std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	// IEEE half float, rounded to nearest
+	GLushort to_half(float value)
+	{
+		std::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		std::uint32_t sign = (bits >> 16) & 0x8000;
+		std::uint32_t mantissa = bits & 0x7FFFFF;
+		int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+
+		if (((bits >> 23) & 0xFF) == 0xFF) // infinity or NaN
+			return static_cast<GLushort>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+		if (exponent >= 31) // too large
+			return static_cast<GLushort>(sign | 0x7C00);
+		if (exponent <= 0) // subnormal or zero
+		{
+			if (exponent < -10)
+				return static_cast<GLushort>(sign);
+			mantissa |= 0x800000;
+			int shift = 14 - exponent;
+			std::uint32_t half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1)
+				half++;
+			return static_cast<GLushort>(sign | half);
+		}
+
+		// A carry out of the mantissa correctly moves to the next exponent
+		std::uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000)
+			half++;
+		return static_cast<GLushort>(half);
+	}
 }
 
-MyGL::Mesh::Mesh(const std::vector<glm::vec3> &vertices,
-				 const std::vector<GLuint> &indices)
-	: indices(indices)
+MyGL::Mesh::Mesh(Span<Vertex> vertices,
+				 Span<GLuint> indices,
+				 GLenum usage,
+				 size_t chunk_triangles,
+				 VertexFormat format)
+	: usage(usage), positions_only(false), format(format), chunk_triangles(chunk_triangles)
 {
-	this->vertices.reserve(vertices.size());
-	for (const auto &vertex : vertices)
-		this->vertices.push_back({vertex, glm::vec3(0.0f), glm::vec2(0.0f)});
+	setup();
+	update(vertices, indices);
+}
 
+MyGL::Mesh::Mesh(Span<glm::vec3> vertices,
+				 Span<GLuint> indices,
+				 GLenum usage,
+				 size_t chunk_triangles,
+				 VertexFormat format)
+	: usage(usage), positions_only(true), format(format), chunk_triangles(chunk_triangles)
+{
 	setup();
+	update(vertices, indices);
 }
 
 MyGL::Mesh::~Mesh()
@@ -23,21 +95,105 @@ MyGL::Mesh::~Mesh()
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
+	glDeleteTextures(1, &bounds_texture);
+	glDeleteBuffers(1, &bounds_buffer);
+}
+
+void MyGL::Mesh::update(Span<Vertex> vertices, Span<GLuint> indices)
+{
+	if (positions_only)
+		throw std::invalid_argument("This mesh only stores positions");
+	upload(vertices.data(), vertices.size(), indices);
+}
+
+void MyGL::Mesh::update(Span<glm::vec3> vertices, Span<GLuint> indices)
+{
+	if (!positions_only)
+		throw std::invalid_argument("This mesh stores full vertices");
+	upload(vertices.data(), vertices.size(), indices);
+}
+
+void MyGL::Mesh::update_vertices(Span<Vertex> vertices, size_t first)
+{
+	if (format == VertexFormat::Compact)
+		throw std::logic_error("Compact meshes cannot be updated in place");
+	if (positions_only)
+		throw std::invalid_argument("This mesh only stores positions");
+	upload_range(vertices.data(), first, vertices.size());
+}
+
+void MyGL::Mesh::update_positions(Span<glm::vec3> positions, size_t first)
+{
+	if (format == VertexFormat::Compact)
+		throw std::logic_error("Compact meshes cannot be updated in place");
+	if (!positions_only)
+		throw std::invalid_argument("This mesh stores full vertices");
+	upload_range(positions.data(), first, positions.size());
 }
 
 void MyGL::Mesh::draw()
 {
-	glBindVertexArray(VAO);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	draw_chunks(nullptr);
 }
 
 void MyGL::Mesh::draw_wireframe()
 {
-	glBindVertexArray(VAO);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	draw_chunks(nullptr);
+}
+
+void MyGL::Mesh::draw(const Frustum &frustum)
+{
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	draw_chunks(&frustum);
+}
+
+void MyGL::Mesh::draw_wireframe(const Frustum &frustum)
+{
+	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	draw_chunks(&frustum);
+}
+
+void MyGL::Mesh::draw_chunks(const Frustum *frustum)
+{
+	draw_counts.clear();
+	draw_offsets.clear();
+	draw_base_vertices.clear();
+	n_drawn_triangles = 0;
+
+	// Chunks are in index order, so consecutive visible chunks with the same base
+	// vertex (all of them in the float format) merge into one range
+	GLsizei range_end = -1;
+	for (const auto &chunk : chunks)
+	{
+		if (frustum && !frustum->intersects_box(chunk.lower, chunk.upper))
+			continue;
+
+		if (chunk.first == range_end && chunk.base_vertex == draw_base_vertices.back())
+			draw_counts.back() += chunk.count;
+		else
+		{
+			draw_counts.push_back(chunk.count);
+			draw_offsets.push_back(reinterpret_cast<const void *>(chunk.first * index_size()));
+			draw_base_vertices.push_back(chunk.base_vertex);
+		}
+		range_end = chunk.first + chunk.count;
+		n_drawn_triangles += chunk.count / 3;
+	}
+
+	if (draw_counts.empty())
+		return;
+
+	if (format == VertexFormat::Compact)
+	{
+		glActiveTexture(GL_TEXTURE0 + CHUNK_BOUNDS_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_BUFFER, bounds_texture);
+	}
+
+	glBindVertexArray(VAO);
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, draw_counts.data(), index_type, draw_offsets.data(),
+								  static_cast<GLsizei>(draw_counts.size()), draw_base_vertices.data());
 	glBindVertexArray(0);
 }
 
@@ -50,20 +206,306 @@ void MyGL::Mesh::setup()
 	glBindVertexArray(VAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	if (format == VertexFormat::Compact)
+	{
+		GLsizei stride = static_cast<GLsizei>(this->stride());
+		// Grid steps from the origin of the chunk
+		glEnableVertexAttribArray(0);
+		glVertexAttribIPointer(0, 3, GL_UNSIGNED_SHORT, stride, (void *)offsetof(CompactVertex, position));
+		// Chunk
+		glEnableVertexAttribArray(3);
+		glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, stride, (void *)offsetof(CompactVertex, chunk));
+		if (!positions_only)
+		{
+			// Octahedral normal
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void *)offsetof(CompactVertex, normal));
+			// TexCoords
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void *)offsetof(CompactVertex, tex_coords));
+		}
+
+		glGenBuffers(1, &bounds_buffer);
+		glGenTextures(1, &bounds_texture);
+
+		glBindVertexArray(0);
+		return;
+	}
 
 	// Position
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
-	// Normal
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
-	// TexCoords
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, tex_coords));
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertex_size(), (void *)0);
+	// Without these, normal and tex_coords read the default attribute value (zero)
+	if (!positions_only)
+	{
+		// Normal
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+		// TexCoords
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, tex_coords));
+	}
 
 	glBindVertexArray(0);
-}
\ No newline at end of file
+}
+
+void MyGL::Mesh::upload(const void *vertices, size_t n_vertices, Span<GLuint> indices)
+{
+	if (indices.size() % 3 != 0)
+		throw std::invalid_argument("The number of indices must be a multiple of three");
+
+	// Chunking reads the vertex of every index, so check them all first
+	if (std::any_of(indices.begin(), indices.end(), [&](GLuint index)
+					{ return index >= n_vertices; }))
+		throw std::out_of_range("Vertex index outside of the mesh");
+
+	this->n_vertices = n_vertices;
+	n_indices = static_cast<GLsizei>(indices.size());
+
+	std::vector<GLuint> ordered = build_chunks(vertices, indices);
+	if (!ordered.empty())
+		indices = ordered;
+
+	if (format == VertexFormat::Compact)
+	{
+		upload_compact(vertices, indices);
+		return;
+	}
+	n_stored_vertices = n_vertices;
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, n_vertices * vertex_size(), vertices, usage);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(), usage);
+
+	glBindVertexArray(0);
+}
+
+void MyGL::Mesh::upload_compact(const void *vertices, Span<GLuint> indices)
+{
+	if (chunks.size() > std::numeric_limits<GLushort>::max() + size_t(1))
+		throw std::invalid_argument("A compact mesh has at most 65536 chunks");
+
+	// Each chunk gets its own copy of the vertices it uses, indexed from its base vertex
+	std::vector<GLuint> local_indices(indices.size());
+	std::vector<GLuint> sources; // input vertex of each stored vertex
+	std::vector<GLuint> local(n_vertices);
+	std::vector<size_t> used_by(n_vertices, chunks.size());
+	size_t max_chunk_vertices = 0;
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		MeshChunk &chunk = chunks[c];
+		chunk.base_vertex = static_cast<GLint>(sources.size());
+		for (GLsizei i = chunk.first; i < chunk.first + chunk.count; i++)
+		{
+			GLuint vertex = indices[i];
+			if (used_by[vertex] != c)
+			{
+				used_by[vertex] = c;
+				local[vertex] = static_cast<GLuint>(sources.size() - chunk.base_vertex);
+				sources.push_back(vertex);
+			}
+			local_indices[i] = local[vertex];
+		}
+		max_chunk_vertices = std::max(max_chunk_vertices, sources.size() - chunk.base_vertex);
+	}
+	n_stored_vertices = sources.size();
+
+	// One grid for all chunks, so that the copies of a vertex in different chunks
+	// decode to the same position and the chunks do not crack apart. Its step lets
+	// the largest chunk span 16 bits (less one step for rounding its origin down),
+	// and keeps grid coordinates below 2^24, where floats add them exactly.
+	glm::vec3 lower(0.0f), upper(0.0f), extent(0.0f);
+	if (!chunks.empty())
+	{
+		lower = chunks[0].lower;
+		upper = chunks[0].upper;
+	}
+	for (const auto &chunk : chunks)
+	{
+		lower = glm::min(lower, chunk.lower);
+		upper = glm::max(upper, chunk.upper);
+		extent = glm::max(extent, chunk.upper - chunk.lower);
+	}
+	glm::vec3 step = glm::max(extent / 65533.0f, (upper - lower) / 16777215.0f);
+	for (int k = 0; k < 3; k++)
+		if (!(step[k] > 0.0f))
+			step[k] = 1.0f;
+
+	// Grid lower corner and step, then the origin of each chunk in steps
+	std::vector<glm::vec4> bounds(2 + chunks.size());
+	bounds[0] = glm::vec4(lower, 0.0f);
+	bounds[1] = glm::vec4(step, 0.0f);
+	for (size_t c = 0; c < chunks.size(); c++)
+		for (int k = 0; k < 3; k++)
+			bounds[2 + c][k] = std::floor((chunks[c].lower[k] - lower[k]) / step[k]);
+
+	// Vertices, cut to the stride if there are only positions
+	std::vector<unsigned char> data(n_stored_vertices * stride());
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		const MeshChunk &chunk = chunks[c];
+		const glm::vec4 &origin = bounds[2 + c];
+
+		size_t end = c + 1 < chunks.size() ? chunks[c + 1].base_vertex : n_stored_vertices;
+		for (size_t i = chunk.base_vertex; i < end; i++)
+		{
+			CompactVertex compact = {};
+			const glm::vec3 &p = position(vertices, sources[i]);
+			for (int k = 0; k < 3; k++)
+				compact.position[k] = quantize(p[k], lower[k], step[k], origin[k]);
+			compact.chunk = static_cast<GLushort>(c);
+			if (!positions_only)
+			{
+				const Vertex &vertex = static_cast<const Vertex *>(vertices)[sources[i]];
+				encode_octahedral(vertex.normal, compact.normal);
+				compact.tex_coords[0] = to_half(vertex.tex_coords.x);
+				compact.tex_coords[1] = to_half(vertex.tex_coords.y);
+			}
+			std::memcpy(data.data() + i * stride(), &compact, stride());
+		}
+	}
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), usage);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	if (max_chunk_vertices <= std::numeric_limits<GLushort>::max() + size_t(1))
+	{
+		index_type = GL_UNSIGNED_SHORT;
+		std::vector<GLushort> short_indices(local_indices.begin(), local_indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, short_indices.size() * sizeof(GLushort), short_indices.data(), usage);
+	}
+	else
+	{
+		index_type = GL_UNSIGNED_INT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, local_indices.size() * sizeof(GLuint), local_indices.data(), usage);
+	}
+
+	glBindVertexArray(0);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, bounds_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, bounds.size() * sizeof(glm::vec4), bounds.data(), usage);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_BUFFER, bounds_texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, bounds_buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void MyGL::Mesh::upload_range(const void *vertices, size_t first, size_t count)
+{
+	if (first + count > n_vertices)
+		throw std::out_of_range("Vertex range outside of the mesh");
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferSubData(GL_ARRAY_BUFFER, first * vertex_size(), count * vertex_size(), vertices);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (count == 0)
+		return;
+
+	// Chunks using any vertex of the range grow to cover all of the new positions
+	glm::vec3 lower = position(vertices, 0), upper = lower;
+	for (size_t i = 1; i < count; i++)
+	{
+		lower = glm::min(lower, position(vertices, i));
+		upper = glm::max(upper, position(vertices, i));
+	}
+	for (auto &chunk : chunks)
+	{
+		if (chunk.min_vertex < first + count && chunk.max_vertex >= first)
+		{
+			chunk.lower = glm::min(chunk.lower, lower);
+			chunk.upper = glm::max(chunk.upper, upper);
+		}
+	}
+}
+
+std::vector<GLuint> MyGL::Mesh::build_chunks(const void *vertices, Span<GLuint> indices)
+{
+	chunks.clear();
+	std::vector<GLuint> ordered;
+
+	size_t n_triangles = indices.size() / 3;
+	if (n_triangles == 0)
+		return ordered;
+
+	// Small meshes keep their order as one chunk
+	if (chunk_triangles == 0 || n_triangles <= chunk_triangles)
+	{
+		MeshChunk chunk;
+		chunk.first = 0;
+		chunk.count = n_indices;
+		chunk_bounds(vertices, indices.data(), chunk);
+		chunks.push_back(chunk);
+		return ordered;
+	}
+
+	std::vector<glm::vec3> centroids(n_triangles);
+	for (size_t t = 0; t < n_triangles; t++)
+		centroids[t] = (position(vertices, indices[3 * t]) +
+						position(vertices, indices[3 * t + 1]) +
+						position(vertices, indices[3 * t + 2])) /
+					   3.0f;
+
+	std::vector<GLuint> triangles(n_triangles);
+	std::iota(triangles.begin(), triangles.end(), 0);
+	ordered.reserve(indices.size());
+
+	// Median splits of the centroids along the longest side, depth first so that
+	// neighbouring chunks are also close in the index buffer
+	auto split = [&](auto &split, size_t begin, size_t end) -> void
+	{
+		if (end - begin <= chunk_triangles)
+		{
+			MeshChunk chunk;
+			chunk.first = static_cast<GLsizei>(ordered.size());
+			chunk.count = static_cast<GLsizei>(3 * (end - begin));
+			for (size_t t = begin; t < end; t++)
+				ordered.insert(ordered.end(), indices.begin() + 3 * triangles[t], indices.begin() + 3 * triangles[t] + 3);
+			chunk_bounds(vertices, ordered.data() + chunk.first, chunk);
+			chunks.push_back(chunk);
+			return;
+		}
+
+		glm::vec3 lower = centroids[triangles[begin]], upper = lower;
+		for (size_t t = begin + 1; t < end; t++)
+		{
+			lower = glm::min(lower, centroids[triangles[t]]);
+			upper = glm::max(upper, centroids[triangles[t]]);
+		}
+		glm::vec3 size = upper - lower;
+		int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+
+		size_t half = begin + (end - begin) / 2;
+		std::nth_element(triangles.begin() + begin, triangles.begin() + half, triangles.begin() + end,
+						 [&](GLuint a, GLuint b)
+						 { return centroids[a][axis] < centroids[b][axis]; });
+		split(split, begin, half);
+		split(split, half, end);
+	};
+	split(split, 0, n_triangles);
+
+	return ordered;
+}
+
+void MyGL::Mesh::chunk_bounds(const void *vertices, const GLuint *indices, MeshChunk &chunk) const
+{
+	chunk.lower = chunk.upper = position(vertices, indices[0]);
+	chunk.min_vertex = chunk.max_vertex = indices[0];
+	for (GLsizei i = 1; i < chunk.count; i++)
+	{
+		chunk.lower = glm::min(chunk.lower, position(vertices, indices[i]));
+		chunk.upper = glm::max(chunk.upper, position(vertices, indices[i]));
+		chunk.min_vertex = std::min(chunk.min_vertex, indices[i]);
+		chunk.max_vertex = std::max(chunk.max_vertex, indices[i]);
+	}
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 #include <string>
 
@@ -7,6 +8,8 @@
 #include <glm/glm.hpp>
 
 #include "Shader.h"
+#include "Span.h"
+#include "Frustum.h"
 
 namespace MyGL
 {
@@ -17,26 +20,148 @@ namespace MyGL
 		glm::vec2 tex_coords;
 	};
 
+	// Compact vertices as stored on the GPU (16 bytes, 8 with positions only):
+	// position in steps of a grid shared by all chunks, counted from the origin of
+	// its chunk (16 bits cover the largest chunk), the index of that chunk,
+	// octahedral normal and half-float tex_coords. data/shaders/compact.vert decodes
+	// them with the grid and chunk origins bound to CHUNK_BOUNDS_TEXTURE_UNIT.
+	struct CompactVertex
+	{
+		GLushort position[3];
+		GLushort chunk;
+		GLshort normal[2];
+		GLushort tex_coords[2];
+	};
+
+	enum class VertexFormat
+	{
+		Float,	// Vertex or glm::vec3 as given, 32-bit indices
+		Compact // CompactVertex, 16-bit indices if every chunk has at most 65536 vertices
+	};
+
+	// Texture unit of the buffer texture of compact meshes: grid lower corner, grid
+	// step, then the origin of each chunk in steps
+	const GLuint CHUNK_BOUNDS_TEXTURE_UNIT = 0;
+
+	// Triangles [first, first + count) of the index buffer (counted in indices), with
+	// the bounding box and the range of vertices they use. Indices of compact meshes
+	// are relative to base_vertex.
+	struct MeshChunk
+	{
+		glm::vec3 lower, upper;
+		GLsizei first, count;
+		GLuint min_vertex, max_vertex;
+		GLint base_vertex = 0;
+	};
+
+	// The data only lives in GPU buffers; the input is not kept. usage is the
+	// glBufferData hint, e.g. GL_DYNAMIC_DRAW for vertices updated in place.
+	// Indices past the last vertex throw std::out_of_range before any upload.
+	//
+	// With chunk_triangles > 0, the triangles are reordered into spatially coherent
+	// chunks of at most that many triangles, so that draws given a frustum skip the
+	// chunks outside of it. Otherwise the whole mesh is one chunk.
+	//
+	// The compact format roughly halves the memory of vertices and indices. Each chunk
+	// then gets its own copy of the vertices it uses, and in-place updates are not
+	// available.
 	class Mesh
 	{
 	public:
-		Mesh(const std::vector<Vertex> &vertices,
-			 const std::vector<GLuint> &indices);
+		Mesh(Span<Vertex> vertices,
+			 Span<GLuint> indices,
+			 GLenum usage = GL_STATIC_DRAW,
+			 size_t chunk_triangles = 0,
+			 VertexFormat format = VertexFormat::Float);
 
-		Mesh(const std::vector<glm::vec3> &vertices,
-			 const std::vector<GLuint> &indices);
+		// Positions only (12 bytes per vertex); normal and tex_coords read as zero
+		Mesh(Span<glm::vec3> vertices,
+			 Span<GLuint> indices,
+			 GLenum usage = GL_STATIC_DRAW,
+			 size_t chunk_triangles = 0,
+			 VertexFormat format = VertexFormat::Float);
 
 		~Mesh();
 
+		// Replaces the geometry and reuses the buffers, e.g. to render many meshes.
+		// The vertex type must match the constructor.
+		void update(Span<Vertex> vertices, Span<GLuint> indices);
+		void update(Span<glm::vec3> vertices, Span<GLuint> indices);
+
+		// Overwrites vertices [first, first + vertices.size()) in place. Chunk bounds
+		// only grow to cover the new positions; update recomputes them tightly.
+		void update_vertices(Span<Vertex> vertices, size_t first = 0);
+		void update_positions(Span<glm::vec3> positions, size_t first = 0);
+
+		// For wireframe over fill, one draw() with data/shaders/wireframe.geom and
+		// wireframe.frag is cheaper than draw_wireframe() and then draw(): the index
+		// buffer is read once, there is no depth fighting between the two passes, and
+		// GL_LINE polygon mode is slow on many drivers.
 		void draw();
 		void draw_wireframe();
 
+		// Only the chunks intersecting the frustum (of projection * view * model), in
+		// one glMultiDrawElementsBaseVertex
+		void draw(const Frustum &frustum);
+		void draw_wireframe(const Frustum &frustum);
+
+		GLsizei get_n_triangles() const { return n_indices / 3; }
+		// Triangles of the last draw
+		GLsizei get_n_drawn_triangles() const { return n_drawn_triangles; }
+
+		const std::vector<MeshChunk> &get_chunks() const { return chunks; }
+		VertexFormat get_format() const { return format; }
+
+		// Sizes of the buffers on the GPU
+		size_t get_vertex_bytes() const { return n_stored_vertices * stride(); }
+		size_t get_index_bytes() const { return n_indices * index_size(); }
+
 	private:
 		GLuint VAO, VBO, EBO;
+		GLuint bounds_buffer = 0, bounds_texture = 0; // compact format only
 
-		std::vector<Vertex> vertices;
-		std::vector<GLuint> indices;
+		GLenum usage;
+		bool positions_only;
+		VertexFormat format;
+		size_t n_vertices = 0;		  // as given
+		size_t n_stored_vertices = 0; // on the GPU, with copies between chunks
+		GLsizei n_indices = 0;
+		GLenum index_type = GL_UNSIGNED_INT;
+
+		size_t chunk_triangles;
+		std::vector<MeshChunk> chunks;
+
+		// Visible ranges of the index buffer, reused by every draw
+		std::vector<GLsizei> draw_counts;
+		std::vector<const void *> draw_offsets;
+		std::vector<GLint> draw_base_vertices;
+		GLsizei n_drawn_triangles = 0;
 
 		void setup();
+		void upload(const void *vertices, size_t n_vertices, Span<GLuint> indices);
+		void upload_compact(const void *vertices, Span<GLuint> indices);
+		void upload_range(const void *vertices, size_t first, size_t count);
+		void draw_chunks(const Frustum *frustum);
+
+		// Input vertex (Vertex or glm::vec3)
+		size_t vertex_size() const { return positions_only ? sizeof(glm::vec3) : sizeof(Vertex); }
+		// Vertex in the buffer
+		size_t stride() const
+		{
+			if (format == VertexFormat::Compact)
+				return positions_only ? offsetof(CompactVertex, normal) : sizeof(CompactVertex);
+			return vertex_size();
+		}
+		size_t index_size() const { return index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+
+		// Position of vertex i in an array of vertices of this mesh's type
+		const glm::vec3 &position(const void *vertices, size_t i) const
+		{
+			return *reinterpret_cast<const glm::vec3 *>(static_cast<const char *>(vertices) + i * vertex_size());
+		}
+
+		// Fills chunks and returns the indices in chunk order
+		std::vector<GLuint> build_chunks(const void *vertices, Span<GLuint> indices);
+		void chunk_bounds(const void *vertices, const GLuint *indices, MeshChunk &chunk) const;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,101 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "OffscreenContext.h"
+
+#include <EGL/eglext.h>
+
+MyGL::OffscreenContext::OffscreenContext()
+{
+	setup_EGL();
+	setup_GLAD();
+}
+
+MyGL::OffscreenContext::~OffscreenContext()
+{
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != EGL_NO_CONTEXT)
+		eglDestroyContext(display, context);
+	if (surface != EGL_NO_SURFACE)
+		eglDestroySurface(display, surface);
+	eglTerminate(display);
+}
+
+void MyGL::OffscreenContext::make_current() const
+{
+	if (!eglMakeCurrent(display, surface, surface, context))
+		throw std::runtime_error("Failed to make the offscreen context current");
+}
+
+void MyGL::OffscreenContext::setup_EGL()
+{
+	// Prefer the surfaceless platform, which works without a display
+	const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	bool surfaceless = extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless");
+	if (surfaceless)
+	{
+		auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+			eglGetProcAddress("eglGetPlatformDisplayEXT"));
+		if (get_platform_display)
+			display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (display == EGL_NO_DISPLAY)
+	{
+		surfaceless = false;
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+		throw std::runtime_error("Failed to initialize EGL");
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+		throw std::runtime_error("EGL does not support OpenGL");
+
+	const EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE};
+	EGLConfig config = nullptr;
+	EGLint n_configs = 0;
+	eglChooseConfig(display, config_attributes, &config, 1, &n_configs);
+	if (n_configs == 0 && !surfaceless)
+		throw std::runtime_error("No EGL config for offscreen OpenGL rendering");
+
+	// Set OpenGL version to 3.3
+	const EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE};
+	context = eglCreateContext(display, n_configs ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attributes);
+	if (context == EGL_NO_CONTEXT)
+		throw std::runtime_error("Failed to create an offscreen OpenGL context");
+
+	if (!surfaceless)
+	{
+		const EGLint surface_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+		surface = eglCreatePbufferSurface(display, config, surface_attributes);
+		if (surface == EGL_NO_SURFACE)
+			throw std::runtime_error("Failed to create a pbuffer surface");
+	}
+
+	make_current();
+}
+
+void MyGL::OffscreenContext::setup_GLAD() const
+{
+	// Load GLAD
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+	{
+		throw std::runtime_error("Failed to initialize GLAD");
+	}
+
+	// Same state as a Window
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.0, 1.0);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <EGL/egl.h>
+
+#include <glad/glad.h>
+
+namespace MyGL
+{
+	// OpenGL 3.3 context without a window, through EGL. Mesa's surfaceless platform
+	// (llvmpipe) needs neither a GPU nor a display server; other drivers get a 1x1
+	// pbuffer. Render into a Framebuffer.
+	class OffscreenContext
+	{
+	public:
+		OffscreenContext();
+		~OffscreenContext();
+
+		OffscreenContext(const OffscreenContext &) = delete;
+		OffscreenContext &operator=(const OffscreenContext &) = delete;
+
+		void make_current() const;
+
+	private:
+		EGLDisplay display = EGL_NO_DISPLAY;
+		EGLSurface surface = EGL_NO_SURFACE;
+		EGLContext context = EGL_NO_CONTEXT;
+
+		void setup_EGL();
+		void setup_GLAD() const;
+	};
+}
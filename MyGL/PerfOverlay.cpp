@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <imgui.h>
+
+#include "PerfOverlay.h"
+
+namespace
+{
+	// Frames averaged for the numbers shown
+	const unsigned long AVERAGE_FRAMES = 60;
+}
+
+MyGL::PerfOverlay::PerfOverlay(std::vector<std::string> pass_names, std::string csv_path, size_t history_size)
+	: pass_names(std::move(pass_names)), csv_path(std::move(csv_path)),
+	  gpu_timer(static_cast<int>(this->pass_names.size())),
+	  history_size(history_size),
+	  frame_ms(history_size, 0.0f), cpu_ms(history_size, 0.0f), gpu_ms(history_size, 0.0f),
+	  pass_ms(this->pass_names.size(), std::vector<float>(history_size, 0.0f)),
+	  gpu_valid(history_size, 0), draw_calls(history_size, 0), primitives(history_size, 0)
+{
+	if (history_size < 2)
+		throw std::invalid_argument("The history must hold at least two frames");
+}
+
+void MyGL::PerfOverlay::begin_frame()
+{
+	auto now = std::chrono::steady_clock::now();
+	if (frame > 0)
+		frame_ms[slot(frame)] = std::chrono::duration<float, std::milli>(now - frame_start).count();
+	frame_start = now;
+
+	frame++;
+	size_t i = slot(frame);
+	frame_ms[i] = cpu_ms[i] = gpu_ms[i] = 0.0f;
+	gpu_valid[i] = 0;
+	draw_calls[i] = 0;
+	primitives[i] = 0;
+
+	gpu_timer.begin_frame();
+	collect_gpu_times();
+}
+
+void MyGL::PerfOverlay::end_frame()
+{
+	cpu_ms[slot(frame)] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+}
+
+void MyGL::PerfOverlay::count_draw(GLsizei primitives)
+{
+	draw_calls[slot(frame)]++;
+	this->primitives[slot(frame)] += primitives;
+}
+
+void MyGL::PerfOverlay::collect_gpu_times()
+{
+	// Results arrive a few frames late; drop them if the frame left the history
+	unsigned long result_frame = gpu_timer.get_result_frame();
+	if (result_frame == 0 || frame - result_frame >= history_size || gpu_valid[slot(result_frame)])
+		return;
+
+	size_t i = slot(result_frame);
+	gpu_ms[i] = 0.0f;
+	for (size_t pass = 0; pass < pass_names.size(); pass++)
+	{
+		pass_ms[pass][i] = static_cast<float>(gpu_timer.get_milliseconds(static_cast<int>(pass)));
+		gpu_ms[i] += pass_ms[pass][i];
+	}
+	gpu_valid[i] = 1;
+}
+
+void MyGL::PerfOverlay::draw()
+{
+	// Averages over the last complete frames
+	unsigned long n_frames = frame > 0 ? std::min<unsigned long>(filled() - 1, AVERAGE_FRAMES) : 0;
+	double frame_mean = 0, cpu_mean = 0, gpu_mean = 0;
+	std::vector<double> pass_mean(pass_names.size(), 0.0);
+	int gpu_frames = 0;
+	for (unsigned long f = frame - n_frames; f < frame; f++)
+	{
+		size_t i = slot(f);
+		frame_mean += frame_ms[i];
+		cpu_mean += cpu_ms[i];
+		if (!gpu_valid[i])
+			continue;
+		gpu_mean += gpu_ms[i];
+		for (size_t pass = 0; pass < pass_names.size(); pass++)
+			pass_mean[pass] += pass_ms[pass][i];
+		gpu_frames++;
+	}
+	if (n_frames > 0)
+	{
+		frame_mean /= n_frames;
+		cpu_mean /= n_frames;
+	}
+	if (gpu_frames > 0)
+	{
+		gpu_mean /= gpu_frames;
+		for (double &mean : pass_mean)
+			mean /= gpu_frames;
+	}
+
+	ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+	ImGui::SetNextWindowBgAlpha(0.8f);
+	ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+	ImGui::Text("Frame %7.2f ms (%.0f fps)", frame_mean, frame_mean > 0 ? 1000.0 / frame_mean : 0.0);
+	ImGui::Text("CPU   %7.2f ms", cpu_mean);
+	ImGui::Text("GPU   %7.2f ms", gpu_mean);
+	for (size_t pass = 0; pass < pass_names.size(); pass++)
+		ImGui::Text("  %-12s %7.2f ms", pass_names[pass].c_str(), pass_mean[pass]);
+
+	// Whichever side takes most of the frame limits it; if neither does, it waits for vsync
+	const char *bound = "neither (vsync)";
+	if (gpu_mean >= cpu_mean && gpu_mean > 0.8 * frame_mean)
+		bound = "GPU";
+	else if (cpu_mean > 0.8 * frame_mean)
+		bound = "CPU";
+	ImGui::Text("Bound by %s", bound);
+
+	if (frame > 1)
+		ImGui::Text("%d draw calls, %lld primitives", draw_calls[slot(frame - 1)], primitives[slot(frame - 1)]);
+
+	ImGui::Separator();
+	if (solver.edit == 0)
+		ImGui::Text("Solver: %s", solver.busy ? "solving" : "idle");
+	else
+		ImGui::Text("Solve %u: %.3f s (%s)%s", solver.edit, solver.seconds, solver.backend.c_str(),
+					solver.busy ? ", re-solving" : "");
+
+	// History, oldest on the left, on a common scale
+	ImGui::Separator();
+	float scale = *std::max_element(frame_ms.begin(), frame_ms.end());
+	scale = std::max(std::max(scale, *std::max_element(cpu_ms.begin(), cpu_ms.end())),
+					 *std::max_element(gpu_ms.begin(), gpu_ms.end()));
+	int offset = static_cast<int>(frame % history_size);
+	int count = static_cast<int>(history_size);
+	ImGui::PlotLines("Frame", frame_ms.data(), count, offset, nullptr, 0.0f, scale, ImVec2(300.0f, 50.0f));
+	ImGui::PlotLines("CPU", cpu_ms.data(), count, offset, nullptr, 0.0f, scale, ImVec2(300.0f, 50.0f));
+	ImGui::PlotLines("GPU", gpu_ms.data(), count, offset, nullptr, 0.0f, scale, ImVec2(300.0f, 50.0f));
+
+	if (ImGui::Button("Save CSV"))
+	{
+		try
+		{
+			save_csv(csv_path);
+			csv_status = "Saved " + csv_path;
+		}
+		catch (const std::exception &e)
+		{
+			csv_status = e.what();
+		}
+	}
+	if (!csv_status.empty())
+	{
+		ImGui::SameLine();
+		ImGui::Text("%s", csv_status.c_str());
+	}
+
+	ImGui::End();
+}
+
+void MyGL::PerfOverlay::save_csv(const std::string &file_path) const
+{
+	std::ofstream file(file_path);
+	if (!file)
+		throw std::runtime_error("Failed to open file: " + file_path);
+
+	file << "frame,frame_ms,cpu_ms,gpu_ms";
+	for (const auto &name : pass_names)
+		file << ',' << name << "_gpu_ms";
+	file << ",draw_calls,primitives\n";
+
+	// The current frame is not complete yet
+	for (unsigned long f = frame - filled() + 1; f < frame; f++)
+	{
+		size_t i = slot(f);
+		file << f << ',' << frame_ms[i] << ',' << cpu_ms[i] << ',';
+		if (gpu_valid[i])
+			file << gpu_ms[i];
+		for (const auto &ms : pass_ms)
+		{
+			file << ',';
+			if (gpu_valid[i])
+				file << ms[i];
+		}
+		file << ',' << draw_calls[i] << ',' << primitives[i] << '\n';
+	}
+
+	if (!file)
+		throw std::runtime_error("Failed to write file: " + file_path);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "GpuTimer.h"
+
+namespace MyGL
+{
+	// Latest solve, as shown by the overlay
+	struct SolverStats
+	{
+		unsigned edit = 0; // 0 before the first result
+		double seconds = 0;
+		std::string backend;
+		bool busy = false; // a newer edit is queued or being solved
+	};
+
+	// ImGui window with the cost of each frame: CPU time, GPU time per pass (GpuTimer),
+	// draw calls and primitives (triangles or lines), and the latest solve, with a
+	// rolling history that can be saved as CSV. Build it with draw() between
+	// Window::begin_ui_frame and Window::end_ui_frame.
+	class PerfOverlay
+	{
+	public:
+		PerfOverlay(std::vector<std::string> pass_names,
+					std::string csv_path = "perf.csv",
+					size_t history_size = 300);
+
+		// Frame time is measured between begin_frame calls, CPU time from begin_frame
+		// to end_frame (call end_frame before swapping buffers, which waits for vsync)
+		void begin_frame();
+		void end_frame();
+
+		void begin_pass(int pass) { gpu_timer.begin(pass); }
+		void end_pass() { gpu_timer.end(); }
+		void count_draw(GLsizei primitives);
+
+		void set_solver_stats(const SolverStats &stats) { solver = stats; }
+
+		void draw();
+
+		// One row per frame in the history, oldest first; GPU times of the last few
+		// frames are empty until their queries finish
+		void save_csv(const std::string &file_path) const;
+
+	private:
+		std::vector<std::string> pass_names;
+		std::string csv_path;
+		std::string csv_status;
+
+		GpuTimer gpu_timer;
+		std::chrono::steady_clock::time_point frame_start;
+		SolverStats solver;
+
+		// Rings indexed by (frame - 1) % history_size
+		size_t history_size;
+		unsigned long frame = 0;
+		std::vector<float> frame_ms;
+		std::vector<float> cpu_ms;
+		std::vector<float> gpu_ms;				   // all passes
+		std::vector<std::vector<float>> pass_ms; // per pass
+		std::vector<char> gpu_valid;
+		std::vector<int> draw_calls;
+		std::vector<long long> primitives;
+
+		size_t slot(unsigned long frame) const { return (frame - 1) % history_size; }
+		size_t filled() const { return frame < history_size ? frame : history_size; }
+		void collect_gpu_times();
+	};
+}
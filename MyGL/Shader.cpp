@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
+#include <random>
 #include <sstream>
+#include <vector>
 
 #include <stdexcept>
 
@@ -74,6 +79,36 @@ void MyGL::Shader::compile_from_file(const std::string &file_path)
 	}
 }
 
+namespace
+{
+	bool program_binary_supported()
+	{
+		// glad is generated without extension flags, so only the core version counts
+		if (!GLAD_GL_VERSION_4_1)
+			return false;
+
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}
+
+	// FNV-1a, stable across runs and platforms
+	void hash_string(std::uint64_t &hash, const std::string &string)
+	{
+		for (unsigned char c : string)
+			hash = (hash ^ c) * 0x100000001b3ull;
+		hash = (hash ^ 0xff) * 0x100000001b3ull; // separator
+	}
+
+	std::string gl_string(GLenum name)
+	{
+		auto string = glGetString(name);
+		return string ? reinterpret_cast<const char *>(string) : "";
+	}
+}
+
+std::string MyGL::ShaderProgram::binary_cache_directory;
+
 MyGL::ShaderProgram::ShaderProgram()
 {
 	ID = glCreateProgram();
@@ -102,12 +137,64 @@ void MyGL::ShaderProgram::link()
 		glGetProgramInfoLog(ID, 512, nullptr, info_log);
 		throw std::runtime_error("Failed to link program: " + std::string(info_log));
 	}
+
+	cache_uniform_locations();
+}
+
+void MyGL::ShaderProgram::cache_uniform_locations()
+{
+	uniform_locations.clear();
+
+	GLint n_uniforms = 0, max_length = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &n_uniforms);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+	std::vector<char> name(std::max(max_length, 1));
+	for (GLint i = 0; i < n_uniforms; ++i)
+	{
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(ID, i, static_cast<GLsizei>(name.size()), nullptr, &size, &type, name.data());
+
+		// Members of uniform blocks have no location
+		GLint location = glGetUniformLocation(ID, name.data());
+		if (location == -1)
+			continue;
+
+		std::string uniform_name = name.data();
+		uniform_locations[uniform_name] = location;
+
+		// Arrays are reported as "name[0]"
+		if (uniform_name.size() > 3 && uniform_name.compare(uniform_name.size() - 3, 3, "[0]") == 0)
+			uniform_locations[uniform_name.substr(0, uniform_name.size() - 3)] = location;
+	}
 }
 
 void MyGL::ShaderProgram::load_from_file(const std::string &vertex_file_path,
 										 const std::string &fragment_file_path,
 										 const std::string &geometry_file_path)
 {
+	// Binaries depend on the sources and on the driver that compiled them
+	std::string binary_file_path;
+	bool use_cache = !binary_cache_directory.empty() && program_binary_supported();
+	if (use_cache)
+	{
+		std::uint64_t hash = 0xcbf29ce484222325ull;
+		hash_string(hash, Shader::read_file_to_string(vertex_file_path));
+		hash_string(hash, Shader::read_file_to_string(fragment_file_path));
+		if (!geometry_file_path.empty())
+			hash_string(hash, Shader::read_file_to_string(geometry_file_path));
+		for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+			hash_string(hash, gl_string(name));
+
+		std::ostringstream file_name;
+		file_name << std::hex << hash << ".bin";
+		binary_file_path = (std::filesystem::path(binary_cache_directory) / file_name.str()).string();
+
+		if (load_binary(binary_file_path))
+			return;
+	}
+
 	Shader vertex_shader(GL_VERTEX_SHADER);
 	vertex_shader.compile_from_file(vertex_file_path);
 	attach_shader(vertex_shader);
@@ -123,48 +210,168 @@ void MyGL::ShaderProgram::load_from_file(const std::string &vertex_file_path,
 		attach_shader(geometry_shader);
 	}
 
+	if (use_cache)
+		glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	link();
+
+	if (use_cache)
+		save_binary(binary_file_path);
+}
+
+bool MyGL::ShaderProgram::load_binary(const std::string &file_path)
+{
+	std::ifstream file(file_path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	GLenum format;
+	std::vector<char> binary;
+	if (!file.read(reinterpret_cast<char *>(&format), sizeof(format)))
+		return false;
+	binary.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	// The driver rejects binaries of another version; the program is then compiled
+	glProgramBinary(ID, format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	int success;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	if (!success)
+		return false;
+
+	cache_uniform_locations();
+	return true;
+}
+
+void MyGL::ShaderProgram::save_binary(const std::string &file_path) const
+{
+	GLint length = 0;
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	GLenum format;
+	std::vector<char> binary(length);
+	glGetProgramBinary(ID, length, nullptr, &format, binary.data());
+
+	// The cache is an optimization: failing to write it is not an error
+	std::filesystem::path path(file_path);
+	std::error_code error;
+	std::filesystem::create_directories(path.parent_path(), error);
+
+	// Written next to the cache and renamed over it, so that a crash or another
+	// instance writing at the same time never leaves a truncated binary behind
+	auto temp_path = path;
+	temp_path += ".tmp" + std::to_string(std::random_device()());
+	{
+		std::ofstream file(temp_path, std::ios::binary);
+		file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+		file.write(binary.data(), binary.size());
+		file.close();
+		if (!file)
+		{
+			std::filesystem::remove(temp_path, error);
+			return;
+		}
+	}
+
+	std::filesystem::rename(temp_path, path, error);
+	if (error)
+		std::filesystem::remove(temp_path, error);
 }
 
 GLint MyGL::ShaderProgram::get_uniform_location(const std::string &name) const
 {
-	GLint location = glGetUniformLocation(ID, name.c_str());
-	if (location == -1)
+	auto it = uniform_locations.find(name);
+	if (it == uniform_locations.end())
 		throw std::runtime_error("Uniform " + name + " not found in shader program");
-	return location;
+	return it->second;
+}
+
+void MyGL::ShaderProgram::bind_uniform_block(const std::string &name, GLuint binding) const
+{
+	GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+	if (index == GL_INVALID_INDEX)
+		throw std::runtime_error("Uniform block " + name + " not found in shader program");
+	glUniformBlockBinding(ID, index, binding);
+}
+
+void MyGL::ShaderProgram::set_uniform(GLint location, const bool &value) const
+{
+	glUniform1i(location, value);
+}
+
+void MyGL::ShaderProgram::set_uniform(GLint location, const int &value) const
+{
+	glUniform1i(location, value);
+}
+
+void MyGL::ShaderProgram::set_uniform(GLint location, const float &value) const
+{
+	glUniform1f(location, value);
+}
+
+void MyGL::ShaderProgram::set_uniform(GLint location, const glm::vec2 &value) const
+{
+	glUniform2fv(location, 1, &value[0]);
+}
+
+void MyGL::ShaderProgram::set_uniform(GLint location, const glm::vec3 &value) const
+{
+	glUniform3fv(location, 1, &value[0]);
+}
+
+void MyGL::ShaderProgram::set_uniform(GLint location, const glm::vec4 &value) const
+{
+	glUniform4fv(location, 1, &value[0]);
+}
+
+void MyGL::ShaderProgram::set_uniform(GLint location, const glm::mat3 &value) const
+{
+	glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]);
+}
+
+void MyGL::ShaderProgram::set_uniform(GLint location, const glm::mat4 &value) const
+{
+	glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
 }
 
 void MyGL::ShaderProgram::set_uniform(const std::string &name, const bool &value) const
 {
-	glUniform1i(get_uniform_location(name), value);
+	set_uniform(get_uniform_location(name), value);
 }
 
 void MyGL::ShaderProgram::set_uniform(const std::string &name, const int &value) const
 {
-	glUniform1i(get_uniform_location(name), value);
+	set_uniform(get_uniform_location(name), value);
 }
 
 void MyGL::ShaderProgram::set_uniform(const std::string &name, const float &value) const
 {
-	glUniform1f(get_uniform_location(name), value);
+	set_uniform(get_uniform_location(name), value);
+}
+
+void MyGL::ShaderProgram::set_uniform(const std::string &name, const glm::vec2 &value) const
+{
+	set_uniform(get_uniform_location(name), value);
 }
 
 void MyGL::ShaderProgram::set_uniform(const std::string &name, const glm::vec3 &value) const
 {
-	glUniform3fv(get_uniform_location(name), 1, &value[0]);
+	set_uniform(get_uniform_location(name), value);
 }
 
 void MyGL::ShaderProgram::set_uniform(const std::string &name, const glm::vec4 &value) const
 {
-	glUniform4fv(get_uniform_location(name), 1, &value[0]);
+	set_uniform(get_uniform_location(name), value);
 }
 
 void MyGL::ShaderProgram::set_uniform(const std::string &name, const glm::mat3 &value) const
 {
-	glUniformMatrix3fv(get_uniform_location(name), 1, GL_FALSE, &value[0][0]);
+	set_uniform(get_uniform_location(name), value);
 }
 
 void MyGL::ShaderProgram::set_uniform(const std::string &name, const glm::mat4 &value) const
 {
-	glUniformMatrix4fv(get_uniform_location(name), 1, GL_FALSE, &value[0][0]);
+	set_uniform(get_uniform_location(name), value);
 }
\ No newline at end of file
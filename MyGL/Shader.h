@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -18,11 +19,11 @@ namespace MyGL
 		void compile_from_source(const std::string &source);
 		void compile_from_file(const std::string &file_path);
 
+		static std::string read_file_to_string(const std::string &file_path);
+
 	private:
 		GLuint ID;
 		GLenum type;
-
-		static std::string read_file_to_string(const std::string &file_path);
 	};
 
 	class ShaderProgram
@@ -37,13 +38,35 @@ namespace MyGL
 		void link();
 		void use() { glUseProgram(ID); }
 
+		// Uses the binary cache when it is enabled and the driver supports it
 		void load_from_file(const std::string &vertex_file_path,
 							const std::string &fragment_file_path,
 							const std::string &geometry_file_path = "");
 
+		// Linked programs are stored in this directory (keyed by a hash of their
+		// sources and the driver) and loaded from it instead of being compiled again.
+		// Empty (the default) disables the cache.
+		static void set_binary_cache_directory(const std::string &directory) { binary_cache_directory = directory; }
+
+		// Locations are resolved once at link time
+		GLint get_uniform_location(const std::string &name) const;
+
+		// Sources the named uniform block from the uniform buffer bound to binding
+		void bind_uniform_block(const std::string &name, GLuint binding) const;
+
+		void set_uniform(GLint location, const bool &value) const;
+		void set_uniform(GLint location, const int &value) const;
+		void set_uniform(GLint location, const float &value) const;
+		void set_uniform(GLint location, const glm::vec2 &value) const;
+		void set_uniform(GLint location, const glm::vec3 &value) const;
+		void set_uniform(GLint location, const glm::vec4 &value) const;
+		void set_uniform(GLint location, const glm::mat3 &value) const;
+		void set_uniform(GLint location, const glm::mat4 &value) const;
+
 		void set_uniform(const std::string &name, const bool &value) const;
 		void set_uniform(const std::string &name, const int &value) const;
 		void set_uniform(const std::string &name, const float &value) const;
+		void set_uniform(const std::string &name, const glm::vec2 &value) const;
 		void set_uniform(const std::string &name, const glm::vec3 &value) const;
 		void set_uniform(const std::string &name, const glm::vec4 &value) const;
 		void set_uniform(const std::string &name, const glm::mat3 &value) const;
@@ -52,6 +75,12 @@ namespace MyGL
 	private:
 		GLuint ID;
 
-		GLint get_uniform_location(const std::string &name) const;
+		std::unordered_map<std::string, GLint> uniform_locations;
+
+		static std::string binary_cache_directory;
+
+		void cache_uniform_locations();
+		bool load_binary(const std::string &file_path);
+		void save_binary(const std::string &file_path) const;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace MyGL
+{
+	// Read-only view of contiguous elements (std::span is C++20). Buffers take spans
+	// so that callers keep the only CPU copy.
+	template <typename T>
+	class Span
+	{
+	public:
+		Span() = default;
+		Span(const T *data, size_t size) : pointer(data), length(size) {}
+		Span(const std::vector<T> &vector) : pointer(vector.data()), length(vector.size()) {}
+		template <size_t N>
+		Span(const std::array<T, N> &array) : pointer(array.data()), length(N) {}
+
+		const T *data() const { return pointer; }
+		size_t size() const { return length; }
+		size_t size_bytes() const { return length * sizeof(T); }
+		bool empty() const { return length == 0; }
+
+		const T *begin() const { return pointer; }
+		const T *end() const { return pointer + length; }
+		const T &operator[](size_t i) const { return pointer[i]; }
+
+	private:
+		const T *pointer = nullptr;
+		size_t length = 0;
+	};
+}
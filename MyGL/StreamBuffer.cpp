@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "StreamBuffer.h"
+
+MyGL::StreamBuffer::StreamBuffer(GLsizeiptr region_size, int n_regions)
+	: region_size(region_size), n_regions(n_regions),
+	  persistent(GLAD_GL_VERSION_4_4), // glad is generated without extension flags
+	  fences(n_regions, nullptr)
+{
+	if (n_regions < 1)
+		throw std::invalid_argument("A stream buffer needs at least one region");
+
+	allocate();
+}
+
+MyGL::StreamBuffer::~StreamBuffer()
+{
+	release();
+}
+
+void MyGL::StreamBuffer::resize(GLsizeiptr region_size)
+{
+	if (region_size == this->region_size)
+		return;
+
+	release();
+	this->region_size = region_size;
+	allocate();
+}
+
+GLintptr MyGL::StreamBuffer::write(const void *data, GLsizeiptr size)
+{
+	if (size > region_size)
+		throw std::invalid_argument("Data does not fit in a region of the stream buffer");
+
+	current = (current + 1) % n_regions;
+	GLintptr offset = current * region_size;
+
+	if (persistent)
+	{
+		// Wait until the GPU has finished the draws of the last round
+		if (GLsync sync = fences[current])
+		{
+			while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+				;
+			glDeleteSync(sync);
+			fences[current] = nullptr;
+		}
+		std::memcpy(mapped + offset, data, size);
+	}
+	else
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, ID);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	return offset;
+}
+
+void MyGL::StreamBuffer::fence()
+{
+	if (!persistent || current < 0)
+		return;
+
+	if (fences[current])
+		glDeleteSync(fences[current]);
+	fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void MyGL::StreamBuffer::allocate()
+{
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_ARRAY_BUFFER, ID);
+
+	// Zero-sized buffers cannot be mapped
+	GLsizeiptr size = std::max<GLsizeiptr>(region_size * n_regions, 1);
+	if (persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+		mapped = static_cast<char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+		if (!mapped)
+			throw std::runtime_error("Failed to map stream buffer");
+	}
+	else
+		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	current = -1;
+}
+
+void MyGL::StreamBuffer::release()
+{
+	for (auto &sync : fences)
+	{
+		if (sync)
+			glDeleteSync(sync);
+		sync = nullptr;
+	}
+
+	if (mapped)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, ID);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		mapped = nullptr;
+	}
+	glDeleteBuffers(1, &ID);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace MyGL
+{
+	// Buffer for data rewritten every frame (or every solve), split into regions used
+	// in turn so that a write never waits for draws still reading the previous one.
+	// With GL 4.4 the regions are persistently mapped and guarded by fences; otherwise
+	// they are written with glBufferSubData.
+	class StreamBuffer
+	{
+	public:
+		StreamBuffer(GLsizeiptr region_size = 0, int n_regions = 3);
+		~StreamBuffer();
+
+		StreamBuffer(const StreamBuffer &) = delete;
+		StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+		GLuint get_ID() const { return ID; }
+		GLsizeiptr get_region_size() const { return region_size; }
+
+		// Reallocates (and forgets the contents) if the size changes
+		void resize(GLsizeiptr region_size);
+
+		// Copies size <= region size bytes into the next region and returns the byte
+		// offset of that region in the buffer
+		GLintptr write(const void *data, GLsizeiptr size);
+
+		// Call after the draws reading the last written region
+		void fence();
+
+	private:
+		GLuint ID = 0;
+
+		GLsizeiptr region_size = 0;
+		int n_regions;
+		int current = -1;
+
+		bool persistent;
+		char *mapped = nullptr;
+		std::vector<GLsync> fences;
+
+		void allocate();
+		void release();
+	};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace MyGL
+{
+	// Binding point of the Matrices block
+	const GLuint MATRICES_BINDING = 0;
+
+	// Per-frame transforms, shared by all programs through the uniform block
+	//     layout (std140) uniform Matrices { mat4 model; mat4 view; mat4 projection; };
+	struct Matrices
+	{
+		glm::mat4 model;
+		glm::mat4 view;
+		glm::mat4 projection;
+	};
+
+	// Uniform buffer holding one T, which must have the std140 layout of the block.
+	// Programs read it after ShaderProgram::bind_uniform_block(name, binding).
+	template <typename T>
+	class UniformBuffer
+	{
+	public:
+		UniformBuffer(GLuint binding)
+			: binding(binding)
+		{
+			glGenBuffers(1, &UBO);
+			glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+			glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			glBindBufferBase(GL_UNIFORM_BUFFER, binding, UBO);
+		}
+
+		~UniformBuffer()
+		{
+			glDeleteBuffers(1, &UBO);
+		}
+
+		UniformBuffer(const UniformBuffer &) = delete;
+		UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+		GLuint get_binding() const { return binding; }
+
+		void update(const T &value)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &value);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+
+	private:
+		GLuint UBO;
+		GLuint binding;
+	};
+}
@@ -41,6 +41,24 @@ void MyGL::Window::poll_events() const
 	glfwPollEvents();
 }
 
+void MyGL::Window::begin_ui_frame() const
+{
+	ImGui_ImplOpenGL3_NewFrame();
+	ImGui_ImplGlfw_NewFrame();
+	ImGui::NewFrame();
+}
+
+void MyGL::Window::end_ui_frame() const
+{
+	ImGui::Render();
+	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
+
+bool MyGL::Window::is_key_pressed(int key) const
+{
+	return glfwGetKey(window, key) == GLFW_PRESS;
+}
+
 void MyGL::Window::process_input() const
 {
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -112,7 +130,7 @@ void MyGL::Window::setup_GLAD() const
 	// Enable depth test
 	glEnable(GL_DEPTH_TEST);
 
-	// Enable polygon offset (for wireframe rendering)
+	// Enable polygon offset (so that lines over faces, e.g. glyphs, pass the depth test)
 	glEnable(GL_POLYGON_OFFSET_FILL);
 	glPolygonOffset(1.0, 1.0);
 }
@@ -26,6 +26,12 @@ namespace MyGL
 		void swap_buffers() const;
 		void poll_events() const;
 
+		// ImGui windows are built between these two calls; end_ui_frame draws them
+		void begin_ui_frame() const;
+		void end_ui_frame() const;
+
+		bool is_key_pressed(int key) const;
+
 		void process_input() const;
 		void process_input_camera(Camera &camera, float delta_time) const;
 
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+
+enum class SolveStage
+{
+	Geometry,	   // local frames and connection
+	Assembly,	   // system and right-hand side
+	Factorization, // direct solvers only
+	Iteration,	   // one conjugate gradient iteration
+	Finished
+};
+
+enum class SolveStatus
+{
+	Converged,
+	Cancelled,		 // the field is left as it was before the solve
+	DeadlineReached, // the field holds the last iterate, if one was reached
+	NotConverged	 // an iterative solver ran out of iterations; the field holds the last iterate
+};
+
+struct SolveProgress
+{
+	SolveStage stage;
+	int iteration = 0; // Iteration only
+	double error = 0;  // relative residual, Iteration only
+};
+
+struct SolveOptions
+{
+	// Called on the solving thread at the start of each stage and after every iteration
+	std::function<void(const SolveProgress &)> progress;
+
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+	// Set from another thread to cancel a synchronous solve at its next iteration or
+	// stage, like SolveHandle::cancel; must outlive the solve
+	const std::atomic<bool> *cancel = nullptr;
+};
+
+// Options of a running solve, plus the flag used to cancel it from another thread
+class SolveControl
+{
+public:
+	SolveControl() = default;
+	explicit SolveControl(SolveOptions options) : options(std::move(options)) {}
+
+	void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+	// Whether the solve should stop now, and why
+	bool interrupted(SolveStatus &status) const
+	{
+		if (cancelled.load(std::memory_order_relaxed) ||
+			(options.cancel && options.cancel->load(std::memory_order_relaxed)))
+			status = SolveStatus::Cancelled;
+		else if (std::chrono::steady_clock::now() >= options.deadline)
+			status = SolveStatus::DeadlineReached;
+		else
+			return false;
+		return true;
+	}
+
+	void report(SolveStage stage, int iteration = 0, double error = 0) const
+	{
+		if (options.progress)
+			options.progress({stage, iteration, error});
+	}
+
+private:
+	SolveOptions options;
+	std::atomic<bool> cancelled{false};
+};
+
+// Result of CrossField::solve_async. The field must not be used until the solve
+// has finished; starting another solve or changing the constraints cancels it.
+class SolveHandle
+{
+public:
+	SolveHandle() = default;
+	SolveHandle(std::shared_ptr<SolveControl> control, std::shared_future<SolveStatus> result)
+		: control(std::move(control)), result(std::move(result)) {}
+
+	bool valid() const { return result.valid(); }
+
+	// Asks the solve to stop at its next iteration or stage
+	void cancel()
+	{
+		if (control)
+			control->cancel();
+	}
+
+	bool ready() const { return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+
+	template <typename Rep, typename Period>
+	bool wait_for(const std::chrono::duration<Rep, Period> &timeout) const
+	{
+		return result.wait_for(timeout) == std::future_status::ready;
+	}
+
+	void wait() const { result.wait(); }
+
+	// Waits for the solve; rethrows its exception if it failed
+	SolveStatus get() const { return result.get(); }
+
+private:
+	std::shared_ptr<SolveControl> control;
+	std::shared_future<SolveStatus> result;
+};
@@ -0,0 +1,169 @@
+#include "SolverBackend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+#ifdef CROSSFIELD_WITH_CHOLMOD
+#include <Eigen/CholmodSupport>
+#endif
+
+namespace
+{
+	using SparseMatrix = SolverBackend::SparseMatrix;
+
+	template <typename Solver>
+	class DirectBackend : public SolverBackend
+	{
+	public:
+		explicit DirectBackend(SolverBackendType type) : backend_type(type) {}
+
+		SolverBackendType type() const override { return backend_type; }
+
+		void analyze_pattern(const SparseMatrix &A) override
+		{
+			solver.analyzePattern(A);
+		}
+
+		void factorize(const SparseMatrix &A) override
+		{
+			solver.factorize(A);
+			if (solver.info() != Eigen::Success)
+				throw std::runtime_error("Failed to decompose the matrix");
+
+			if constexpr (std::is_same_v<Solver, Eigen::SimplicialLDLT<SparseMatrix>>)
+				inv_d = solver.vectorD().cwiseInverse();
+		}
+
+		bool solve(const Eigen::Ref<const Eigen::MatrixXcd> &b, Eigen::Ref<Eigen::MatrixXcd> x) override
+		{
+			if constexpr (std::is_same_v<Solver, Eigen::SimplicialLDLT<SparseMatrix>>)
+			{
+				// The steps of SimplicialLDLT::solve, through a scratch buffer: its final
+				// in-place permutation allocates on every call
+				scratch.resize(b.rows(), b.cols());
+				scratch.noalias() = solver.permutationP() * b;
+				solver.matrixL().solveInPlace(scratch);
+				scratch = inv_d.asDiagonal() * scratch;
+				solver.matrixU().solveInPlace(scratch);
+				x.noalias() = solver.permutationPinv() * scratch;
+			}
+			else
+				x = solver.solve(b);
+			return true;
+		}
+
+	private:
+		SolverBackendType backend_type;
+		Solver solver;
+		Eigen::VectorXcd inv_d;
+		Eigen::MatrixXcd scratch;
+	};
+
+	// Stops at the tolerance or after 2n iterations (Eigen's default), keeping the
+	// last iterate
+	template <typename Solver>
+	class IterativeBackend : public SolverBackend
+	{
+	public:
+		IterativeBackend(SolverBackendType type, double tolerance) : backend_type(type)
+		{
+			solver.setTolerance(tolerance);
+		}
+
+		SolverBackendType type() const override { return backend_type; }
+
+		void analyze_pattern(const SparseMatrix &A) override
+		{
+			solver.analyzePattern(A);
+		}
+
+		void factorize(const SparseMatrix &A) override
+		{
+			solver.factorize(A);
+			if (solver.info() == Eigen::NumericalIssue)
+				throw std::runtime_error("Failed to precondition the matrix");
+		}
+
+		bool solve(const Eigen::Ref<const Eigen::MatrixXcd> &b, Eigen::Ref<Eigen::MatrixXcd> x) override
+		{
+			x = solver.solve(b);
+			return solver.info() == Eigen::Success;
+		}
+
+	private:
+		SolverBackendType backend_type;
+		Solver solver;
+	};
+}
+
+const char *to_string(SolverBackendType type)
+{
+	switch (type)
+	{
+	case SolverBackendType::Auto:
+		return "Auto";
+	case SolverBackendType::LDLT:
+		return "LDLT";
+	case SolverBackendType::SupernodalLLT:
+		return "SupernodalLLT";
+	case SolverBackendType::ConjugateGradient:
+		return "ConjugateGradient";
+	case SolverBackendType::NormalEquationsCG:
+		return "NormalEquationsCG";
+	case SolverBackendType::BiCGSTAB:
+		return "BiCGSTAB";
+	}
+	return "Unknown";
+}
+
+bool supernodal_available()
+{
+#ifdef CROSSFIELD_WITH_CHOLMOD
+	return true;
+#else
+	return false;
+#endif
+}
+
+size_t SolverPolicy::factor_bytes(Eigen::Index unknowns, Eigen::Index non_zeros) const
+{
+	double levels = std::log2(std::max<double>(unknowns, 2));
+	double entries = fill_per_level * non_zeros * levels;
+	return static_cast<size_t>(entries * (sizeof(std::complex<double>) + sizeof(int)));
+}
+
+SolverBackendType SolverPolicy::choose(Eigen::Index unknowns, Eigen::Index non_zeros, int threads) const
+{
+	if (factor_bytes(unknowns, non_zeros) > memory_budget)
+		return SolverBackendType::ConjugateGradient;
+
+	if (supernodal_available() && unknowns >= supernodal_unknowns && threads >= supernodal_threads)
+		return SolverBackendType::SupernodalLLT;
+
+	return SolverBackendType::LDLT;
+}
+
+std::unique_ptr<SolverBackend> make_solver_backend(SolverBackendType type, double tolerance)
+{
+	switch (type)
+	{
+	case SolverBackendType::LDLT:
+		return std::make_unique<DirectBackend<Eigen::SimplicialLDLT<SparseMatrix>>>(type);
+	case SolverBackendType::SupernodalLLT:
+#ifdef CROSSFIELD_WITH_CHOLMOD
+		return std::make_unique<DirectBackend<Eigen::CholmodSupernodalLLT<SparseMatrix>>>(type);
+#else
+		return std::make_unique<DirectBackend<Eigen::SimplicialLLT<SparseMatrix>>>(type);
+#endif
+	case SolverBackendType::ConjugateGradient:
+		return std::make_unique<IterativeBackend<Eigen::ConjugateGradient<SparseMatrix, Eigen::Lower | Eigen::Upper>>>(type, tolerance);
+	case SolverBackendType::NormalEquationsCG:
+		return std::make_unique<IterativeBackend<Eigen::LeastSquaresConjugateGradient<SparseMatrix>>>(type, tolerance);
+	case SolverBackendType::BiCGSTAB:
+		return std::make_unique<IterativeBackend<Eigen::BiCGSTAB<SparseMatrix, Eigen::IncompleteLUT<std::complex<double>>>>>(type, tolerance);
+	default:
+		throw std::invalid_argument("No solver backend for this type");
+	}
+}
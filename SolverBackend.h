@@ -0,0 +1,81 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <memory>
+
+#include <Eigen/Sparse>
+
+// Linear solvers for the assembled cross field system
+enum class SolverBackendType
+{
+	Auto,			   // chosen by SolverPolicy
+	LDLT,			   // Eigen::SimplicialLDLT
+	SupernodalLLT,	   // CHOLMOD supernodal Cholesky (SimplicialLLT without CHOLMOD)
+	ConjugateGradient, // Jacobi-preconditioned CG
+	NormalEquationsCG, // CG on A^H A (Eigen::LeastSquaresConjugateGradient)
+	BiCGSTAB		   // BiCGSTAB with an incomplete LU preconditioner
+};
+
+const char *to_string(SolverBackendType type);
+
+// Whether SupernodalLLT is backed by CHOLMOD in this build
+bool supernodal_available();
+
+// Picks a backend from the size of the system and the number of threads.
+// The thresholds are meant to be tuned from benchmarks of the target machines.
+//
+// The cross field system is Hermitian positive definite, so the policy only picks
+// factorizations or CG; NormalEquationsCG and BiCGSTAB are there to be selected
+// explicitly (e.g. for benchmarks or non-Hermitian variants of the system).
+struct SolverPolicy
+{
+	// Direct factorizations are used while their estimated size fits in the budget
+	size_t memory_budget = size_t(4) << 30;
+
+	// Estimated non-zeros of a factor: fill_per_level * non_zeros * log2(unknowns)
+	double fill_per_level = 1.5;
+
+	// From this many unknowns on, with enough threads, the supernodal factorization
+	// is faster than the simplicial one
+	Eigen::Index supernodal_unknowns = 200000;
+	int supernodal_threads = 4;
+
+	// Relative residual of the iterative backends (the direct ones ignore it). Machine
+	// epsilon is out of reach for CG in double precision, and solve() throws when
+	// it is not reached.
+	double tolerance = 1e-10;
+
+	size_t factor_bytes(Eigen::Index unknowns, Eigen::Index non_zeros) const;
+	SolverBackendType choose(Eigen::Index unknowns, Eigen::Index non_zeros, int threads) const;
+};
+
+class SolverBackend
+{
+public:
+	using SparseMatrix = Eigen::SparseMatrix<std::complex<double>>;
+
+	virtual ~SolverBackend() = default;
+
+	virtual SolverBackendType type() const = 0;
+
+	// Symbolic analysis, which only depends on the sparsity pattern of A
+	virtual void analyze_pattern(const SparseMatrix &A) = 0;
+
+	// Factors (or preconditions) A, whose pattern must be the analyzed one. A must stay
+	// alive until the last solve.
+	virtual void factorize(const SparseMatrix &A) = 0;
+
+	void compute(const SparseMatrix &A)
+	{
+		analyze_pattern(A);
+		factorize(A);
+	}
+
+	// x = A^-1 b, for each column of b; false if an iterative backend stopped before
+	// reaching its tolerance
+	virtual bool solve(const Eigen::Ref<const Eigen::MatrixXcd> &b, Eigen::Ref<Eigen::MatrixXcd> x) = 0;
+};
+
+// type must not be Auto
+std::unique_ptr<SolverBackend> make_solver_backend(SolverBackendType type, double tolerance);
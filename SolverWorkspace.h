@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+#include <Eigen/Sparse>
+
+#include "GeometryKernels.h"
+
+// Scratch buffers for CrossField solves. Buffers grow to the size of the largest
+// problem seen and are reused afterwards, so repeated solves of same-sized meshes
+// do not touch the heap. A workspace can be shared by several CrossFields as long
+// as they do not solve at the same time.
+class SolverWorkspace
+{
+public:
+	using complexd = std::complex<double>;
+
+	// Buffer (re)allocations and bytes requested through this workspace so far
+	size_t allocations() const { return n_allocations; }
+	size_t allocated_bytes() const { return n_allocated_bytes; }
+	void reset_counters()
+	{
+		n_allocations = 0;
+		n_allocated_bytes = 0;
+	}
+
+	// Resize a buffer, counting the allocation if its storage has to change
+	template <typename Derived>
+	void fit(Eigen::PlainObjectBase<Derived> &buffer, Eigen::Index rows, Eigen::Index cols)
+	{
+		if (buffer.size() != rows * cols)
+			count(rows * cols * sizeof(typename Derived::Scalar));
+		buffer.resize(rows, cols);
+	}
+
+	template <typename T>
+	void fit(std::vector<T> &buffer, size_t size)
+	{
+		if constexpr (std::is_move_constructible_v<T>)
+		{
+			if (size > buffer.capacity())
+				count(size * sizeof(T));
+			buffer.resize(size);
+		}
+		else if (size != buffer.size())
+		{
+			// Arrays such as Vector3d[4] cannot be moved by resize()
+			count(size * sizeof(T));
+			buffer = std::vector<T>(size);
+		}
+	}
+
+	void fit(Eigen::SparseMatrix<complexd> &matrix, Eigen::Index size, Eigen::Index non_zeros)
+	{
+		if (matrix.outerSize() != size)
+			count((size + 1) * sizeof(int));
+		if (matrix.data().allocatedSize() < non_zeros)
+			count(non_zeros * (sizeof(complexd) + sizeof(int)));
+		matrix.resize(size, size);
+		matrix.resizeNonZeros(non_zeros);
+	}
+
+	// Geometry
+	GeometryKernels::Vec3Array a, b, c, he_direc;
+	Eigen::ArrayXi f, g;
+	std::vector<int> halfedges;
+	GeometryKernels::ComplexArray e_f_pow2, e_f_pow4, e_g_pow2, e_g_pow4;
+
+	// Corners of VertexCrossField, which uses the buffers above for its edges
+	GeometryKernels::Vec3Array corner_direc;
+	Eigen::ArrayXi corner_f, corner_g;
+	GeometryKernels::ComplexArray corner_f_pow2, corner_f_pow4, corner_g_pow2, corner_g_pow4;
+
+	// Linear system
+	Eigen::SparseMatrix<complexd> A;
+	Eigen::VectorXcd rhs, x, diagonal;
+	Eigen::MatrixXcd rhs_block, x_block;
+
+	// Conjugate gradient
+	Eigen::VectorXcd inv_diagonal, residual, p, z, Ap;
+
+	// Inverse iteration on unconstrained components
+	Eigen::VectorXcd eigen_y, eigen_z;
+
+	// PolyVector root extraction
+	Eigen::ArrayXcd c0, c2, disc, root_a, root_b;
+
+private:
+	size_t n_allocations = 0;
+	size_t n_allocated_bytes = 0;
+
+	void count(size_t bytes)
+	{
+		++n_allocations;
+		n_allocated_bytes += bytes;
+	}
+};
+
+struct ConjugateGradientResult
+{
+	int iterations = 0;
+	double error = 0; // relative residual
+	bool converged = true;
+};
+
+// Jacobi-preconditioned conjugate gradient starting from x, on the workspace
+// vectors (the same iteration as Eigen::ConjugateGradient, without its temporaries).
+// workspace.inv_diagonal must hold the inverse diagonal of A.
+// monitor(iterations, error) is called after every iteration; returning false stops
+// the iteration early, leaving the current iterate in x.
+template <typename Operator, typename Monitor>
+ConjugateGradientResult conjugate_gradient(const Operator &A,
+										   const Eigen::Ref<const Eigen::VectorXcd> &b,
+										   Eigen::Ref<Eigen::VectorXcd> x,
+										   SolverWorkspace &workspace,
+										   double tolerance, int max_iterations,
+										   Monitor &&monitor)
+{
+	const Eigen::Index n = b.size();
+	auto &residual = workspace.residual;
+	auto &p = workspace.p;
+	auto &z = workspace.z;
+	auto &Ap = workspace.Ap;
+
+	workspace.fit(residual, n, 1);
+	workspace.fit(p, n, 1);
+	workspace.fit(z, n, 1);
+	workspace.fit(Ap, n, 1);
+
+	ConjugateGradientResult result;
+
+	double rhs_norm2 = b.squaredNorm();
+	if (rhs_norm2 == 0)
+	{
+		x.setZero();
+		return result;
+	}
+
+	double threshold = std::max(tolerance * tolerance * rhs_norm2, std::numeric_limits<double>::min());
+
+	Ap.noalias() = A * x;
+	residual = b - Ap;
+	double residual_norm2 = residual.squaredNorm();
+
+	p.array() = workspace.inv_diagonal.array() * residual.array();
+	double abs_new = std::real(residual.dot(p));
+
+	while (residual_norm2 >= threshold && result.iterations < max_iterations)
+	{
+		Ap.noalias() = A * p;
+		SolverWorkspace::complexd alpha = abs_new / p.dot(Ap);
+		x += alpha * p;
+		residual -= alpha * Ap;
+		residual_norm2 = residual.squaredNorm();
+		++result.iterations;
+
+		if (residual_norm2 < threshold || !monitor(result.iterations, std::sqrt(residual_norm2 / rhs_norm2)))
+			break;
+
+		z.array() = workspace.inv_diagonal.array() * residual.array();
+		double abs_old = abs_new;
+		abs_new = std::real(residual.dot(z));
+		p = z + (abs_new / abs_old) * p;
+	}
+
+	result.error = std::sqrt(residual_norm2 / rhs_norm2);
+	result.converged = residual_norm2 < threshold;
+	return result;
+}
+
+template <typename Operator>
+ConjugateGradientResult conjugate_gradient(const Operator &A,
+										   const Eigen::Ref<const Eigen::VectorXcd> &b,
+										   Eigen::Ref<Eigen::VectorXcd> x,
+										   SolverWorkspace &workspace,
+										   double tolerance, int max_iterations)
+{
+	return conjugate_gradient(A, b, x, workspace, tolerance, max_iterations, [](int, double)
+							  { return true; });
+}
@@ -0,0 +1,728 @@
+#include "VertexCrossField.h"
+
+#include <algorithm>
+
+namespace
+{
+	// c / |c|, or 0 for edges that are perpendicular to a tangent plane
+	void normalize(GeometryKernels::ComplexArray &c, Eigen::ArrayXcd &out)
+	{
+		out.resize(c.rows());
+		for (Eigen::Index i = 0; i < c.rows(); ++i)
+		{
+			std::complex<double> z(c(i, 0), c(i, 1));
+			double r = std::abs(z);
+			out[i] = r > 0 ? z / r : 0.0;
+		}
+	}
+}
+
+VertexCrossField::VertexCrossField(Mesh &input_mesh, FieldType type)
+	: mesh(input_mesh), field_type(type)
+{
+}
+
+void VertexCrossField::set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+									   const std::vector<Eigen::Vector2d> &directions)
+{
+	if (faces.size() != directions.size())
+		throw std::invalid_argument("The number of faces and directions must be the same");
+
+	constraints_faces = faces;
+	constraints_directions = to_constraint_frames(directions);
+	constraints_weights.clear();
+}
+
+void VertexCrossField::set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+									   const std::vector<std::array<Eigen::Vector2d, 2>> &frames)
+{
+	if (faces.size() != frames.size())
+		throw std::invalid_argument("The number of faces and frames must be the same");
+
+	constraints_faces = faces;
+	constraints_directions = to_constraint_frames(frames);
+	constraints_weights.clear();
+}
+
+void VertexCrossField::set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+											const std::vector<Eigen::Vector2d> &directions,
+											const std::vector<double> &weights)
+{
+	if (faces.size() != weights.size())
+		throw std::invalid_argument("The number of faces and weights must be the same");
+	if (std::any_of(weights.begin(), weights.end(), [](double w)
+					{ return !(w > 0); }))
+		throw std::invalid_argument("Constraint weights must be positive");
+
+	set_constraints(faces, directions);
+	constraints_weights = weights;
+}
+
+void VertexCrossField::set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+											const std::vector<std::array<Eigen::Vector2d, 2>> &frames,
+											const std::vector<double> &weights)
+{
+	if (faces.size() != weights.size())
+		throw std::invalid_argument("The number of faces and weights must be the same");
+	if (std::any_of(weights.begin(), weights.end(), [](double w)
+					{ return !(w > 0); }))
+		throw std::invalid_argument("Constraint weights must be positive");
+
+	set_constraints(faces, frames);
+	constraints_weights = weights;
+}
+
+VertexCrossField::ConstraintFrames VertexCrossField::to_constraint_frames(const std::vector<Eigen::Vector2d> &directions)
+{
+	ConstraintFrames constraint_frames(directions.size());
+	for (size_t i = 0; i < directions.size(); ++i)
+	{
+		auto direc = directions[i].normalized();
+		auto u = complexd(direc.x(), direc.y());
+		constraint_frames[i] = {u, complexd(0, 1) * u};
+	}
+	return constraint_frames;
+}
+
+VertexCrossField::ConstraintFrames VertexCrossField::to_constraint_frames(const std::vector<std::array<Eigen::Vector2d, 2>> &frames)
+{
+	ConstraintFrames constraint_frames(frames.size());
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		const auto &[u, v] = frames[i];
+		if (u.squaredNorm() == 0 || v.squaredNorm() == 0)
+			throw std::invalid_argument("Constraint frames must not contain zero vectors");
+		constraint_frames[i] = {complexd(u.x(), u.y()), complexd(v.x(), v.y())};
+	}
+	return constraint_frames;
+}
+
+std::array<VertexCrossField::complexd, 2> VertexCrossField::constraint_coefficients(const std::array<complexd, 2> &frame) const
+{
+	const auto &[u, v] = frame;
+
+	if (field_type == FieldType::PolyVector)
+		return {u * u * v * v, -(u * u + v * v)};
+	else
+		return {u * u * u * u, 0.0};
+}
+
+void VertexCrossField::decode(const std::array<complexd, 2> &coefficients,
+							  const Eigen::Vector3d &u, const Eigen::Vector3d &v,
+							  Eigen::Vector3d (&field)[4]) const
+{
+	if (field_type == FieldType::PolyVector)
+	{
+		// roots {a, b, -a, -b} of z^4 + x_2 z^2 + x_0, see CrossField::extract_polyvector_roots
+		const auto &[c0, c2] = coefficients;
+		complexd disc = std::sqrt(c2 * c2 - 4.0 * c0);
+		complexd a = std::sqrt(0.5 * (disc - c2));
+		complexd b = std::sqrt(-0.5 * (disc + c2));
+		if ((std::conj(a) * b).imag() < 0)
+			b = -b;
+
+		Eigen::Vector3d a_3d = a.real() * u + a.imag() * v;
+		Eigen::Vector3d b_3d = b.real() * u + b.imag() * v;
+		field[0] = a_3d;
+		field[1] = b_3d;
+		field[2] = -a_3d;
+		field[3] = -b_3d;
+		return;
+	}
+
+	double arg = std::arg(coefficients[0]) / 4;
+	for (int k = 0; k < 4; ++k)
+	{
+		double angle = arg + k * M_PI / 2;
+		field[k] = cos(angle) * u + sin(angle) * v;
+	}
+}
+
+void VertexCrossField::solve()
+{
+	if (solve(SolveOptions()) == SolveStatus::NotConverged)
+		throw std::runtime_error("The iterative solver did not converge");
+}
+
+SolveStatus VertexCrossField::solve(const SolveOptions &options)
+{
+	SolveControl control(options);
+
+	if (!geometry_ready)
+	{
+		control.report(SolveStage::Geometry);
+		prepare_geometry();
+	}
+
+	SolveStatus status;
+	if (control.interrupted(status))
+		return status;
+
+	status = solve_vector_field(control);
+	control.report(SolveStage::Finished);
+	return status;
+}
+
+std::vector<Eigen::Vector3d[4]> VertexCrossField::extract_cross_field()
+{
+	std::vector<Eigen::Vector3d[4]> cross_field;
+	extract_cross_field(cross_field);
+	return cross_field;
+}
+
+void VertexCrossField::extract_cross_field(std::vector<Eigen::Vector3d[4]> &cross_field)
+{
+	check_solved();
+
+	const int n = n_coefficients();
+	const int n_faces = mesh.n_faces();
+
+	workspace->fit(cross_field, n_faces);
+
+	for (int f = 0; f < n_faces; ++f)
+	{
+		// Average of the vertex coefficients, transported into the face frame
+		std::array<complexd, 2> coefficients = {0.0, 0.0};
+		for (int c = 3 * f; c < 3 * (f + 1); ++c)
+			for (int k = 0; k < n; ++k)
+				coefficients[k] += corner_transport[k][c] * x[n * corner_vertex[c] + k] / 3.0;
+
+		decode(coefficients, local_frame.u.row(f), local_frame.v.row(f), cross_field[f]);
+	}
+}
+
+std::vector<Eigen::Vector3d[4]> VertexCrossField::extract_vertex_cross_field()
+{
+	check_solved();
+
+	const int n = n_coefficients();
+	const int n_faces = mesh.n_faces();
+
+	std::vector<Eigen::Vector3d[4]> cross_field(mesh.n_vertices());
+	for (int i = 0; i < mesh.n_vertices(); ++i)
+	{
+		std::array<complexd, 2> coefficients = {x[n * i], n > 1 ? x[n * i + 1] : 0.0};
+		decode(coefficients, local_frame.u.row(n_faces + i), local_frame.v.row(n_faces + i), cross_field[i]);
+	}
+	return cross_field;
+}
+
+void VertexCrossField::check_solved() const
+{
+	if (!geometry_ready || x.size() != n_coefficients() * mesh.n_vertices())
+		throw std::runtime_error("The field must be solved before it is extracted");
+}
+
+void VertexCrossField::prepare_geometry()
+{
+	if (geometry_ready)
+		return;
+
+	compute_local_frames();
+	compute_connection();
+	group_components();
+	geometry_ready = true;
+	system_ready = false;
+}
+
+void VertexCrossField::group_components()
+{
+	// Label the connected components in the order they first appear
+	const int n_vertices = mesh.n_vertices();
+	vertex_component.assign(n_vertices, -1);
+	component_size.clear();
+	std::vector<int> queue;
+	queue.reserve(n_vertices);
+
+	for (int seed = 0; seed < n_vertices; ++seed)
+	{
+		if (vertex_component[seed] >= 0)
+			continue;
+
+		int component = component_size.size();
+		queue.assign(1, seed);
+		vertex_component[seed] = component;
+		for (size_t head = 0; head < queue.size(); ++head)
+			for (const auto &v : mesh.vv_range(mesh.vertex_handle(queue[head])))
+				if (vertex_component[v.idx()] < 0)
+				{
+					vertex_component[v.idx()] = component;
+					queue.push_back(v.idx());
+				}
+		component_size.push_back(queue.size());
+	}
+
+	// The smoothest fields depend on the geometry only
+	smoothest_ready.assign(component_size.size(), false);
+}
+
+void VertexCrossField::compute_local_frames()
+{
+	const int n_faces = mesh.n_faces();
+	const int n_vertices = mesh.n_vertices();
+
+	// Face frames as in CrossField, so constraint directions mean the same
+	auto &ws = *workspace;
+	auto &a = ws.a, &b = ws.b, &c = ws.c;
+	for (auto *buffer : {&a, &b, &c})
+		ws.fit(*buffer, n_faces, 3);
+
+	for (const auto &f : mesh.faces())
+	{
+		auto he = f.halfedge();
+		a.row(f.idx()) = mesh.point(he.from());
+		b.row(f.idx()) = mesh.point(he.to());
+		c.row(f.idx()) = mesh.point(he.next().to());
+	}
+
+	GeometryKernels::Vec3Array face_n, face_u, face_v;
+	GeometryKernels::compute_local_frames(a, b, c, face_n, face_u, face_v);
+
+	local_frame.n.resize(n_faces + n_vertices, 3);
+	local_frame.u.resize(n_faces + n_vertices, 3);
+	local_frame.v.resize(n_faces + n_vertices, 3);
+	local_frame.n.topRows(n_faces) = face_n;
+	local_frame.u.topRows(n_faces) = face_u;
+	local_frame.v.topRows(n_faces) = face_v;
+
+	// Vertex normals are area weighted face normals
+	local_frame.n.bottomRows(n_vertices).setZero();
+	for (int f = 0; f < n_faces; ++f)
+	{
+		Eigen::Vector3d area_normal = (b.row(f) - a.row(f)).matrix().cross((c.row(f) - a.row(f)).matrix());
+		for (const auto &v : mesh.fv_range(mesh.face_handle(f)))
+			local_frame.n.row(n_faces + v.idx()) += area_normal.transpose().array();
+	}
+
+	// u is the first outgoing edge projected onto the tangent plane
+	for (const auto &v : mesh.vertices())
+	{
+		int row = n_faces + v.idx();
+		Eigen::Vector3d normal = local_frame.n.row(row).matrix().normalized();
+
+		Eigen::Vector3d u = Eigen::Vector3d::Zero();
+		if (v.halfedge().is_valid())
+		{
+			Eigen::Vector3d d = mesh.point(v.halfedge().to()) - mesh.point(v);
+			u = (d - d.dot(normal) * normal).normalized();
+		}
+
+		local_frame.n.row(row) = normal;
+		local_frame.u.row(row) = u;
+		local_frame.v.row(row) = normal.cross(u);
+	}
+}
+
+void VertexCrossField::compute_connection()
+{
+	const int n_faces = mesh.n_faces();
+	const Eigen::Index n_edges = mesh.n_edges();
+	auto &ws = *workspace;
+
+	// Edges between the frames of their end vertices
+	auto &d = ws.he_direc;
+	ws.fit(d, n_edges, 3);
+	edge_from.resize(n_edges);
+	edge_to.resize(n_edges);
+
+	auto &f = ws.f, &g = ws.g;
+	ws.fit(f, n_edges, 1);
+	ws.fit(g, n_edges, 1);
+
+	for (const auto &e : mesh.edges())
+	{
+		auto he = e.h0();
+		d.row(e.idx()) = mesh.point(he.to()) - mesh.point(he.from());
+		edge_from[e.idx()] = he.from().idx();
+		edge_to[e.idx()] = he.to().idx();
+	}
+	f = edge_from + n_faces;
+	g = edge_to + n_faces;
+
+	// Unlike across face edges, an edge is not in the tangent planes of its
+	// vertices, so the projected directions are renormalized
+	auto &e_f_pow2 = ws.e_f_pow2, &e_f_pow4 = ws.e_f_pow4, &e_g_pow2 = ws.e_g_pow2, &e_g_pow4 = ws.e_g_pow4;
+	GeometryKernels::compute_connection(d, f, g, local_frame.u, local_frame.v,
+										e_f_pow2, e_f_pow4, e_g_pow2, e_g_pow4);
+	normalize(e_f_pow4, from_conj_pow[0]);
+	normalize(e_f_pow2, from_conj_pow[1]);
+	normalize(e_g_pow4, to_conj_pow[0]);
+	normalize(e_g_pow2, to_conj_pow[1]);
+
+	// Corners: the outgoing edge of each corner seen from the face and from the vertex
+	const Eigen::Index n_corners = 3 * n_faces;
+	auto &corner_d = ws.corner_direc;
+	auto &corner_f = ws.corner_f, &corner_g = ws.corner_g;
+	ws.fit(corner_d, n_corners, 3);
+	ws.fit(corner_f, n_corners, 1);
+	ws.fit(corner_g, n_corners, 1);
+	corner_vertex.resize(n_corners);
+
+	for (const auto &face : mesh.faces())
+	{
+		int corner = 3 * face.idx();
+		for (const auto &he : mesh.fh_range(face))
+		{
+			corner_d.row(corner) = mesh.point(he.to()) - mesh.point(he.from());
+			corner_f[corner] = face.idx();
+			corner_g[corner] = n_faces + he.from().idx();
+			corner_vertex[corner] = he.from().idx();
+			++corner;
+		}
+	}
+
+	GeometryKernels::compute_connection(corner_d, corner_f, corner_g, local_frame.u, local_frame.v,
+										ws.corner_f_pow2, ws.corner_f_pow4, ws.corner_g_pow2, ws.corner_g_pow4);
+
+	// A vector at the angle of the edge in the vertex frame lands at the angle of
+	// the edge in the face frame: x_face = conj(c_face) c_vertex x_vertex
+	Eigen::ArrayXcd face_conj_pow, vertex_conj_pow;
+	GeometryKernels::ComplexArray *face_pow[2] = {&ws.corner_f_pow4, &ws.corner_f_pow2};
+	GeometryKernels::ComplexArray *vertex_pow[2] = {&ws.corner_g_pow4, &ws.corner_g_pow2};
+	for (int k = 0; k < 2; ++k)
+	{
+		normalize(*face_pow[k], face_conj_pow);
+		normalize(*vertex_pow[k], vertex_conj_pow);
+		corner_transport[k] = face_conj_pow.conjugate() * vertex_conj_pow;
+	}
+}
+
+void VertexCrossField::gather_constraints(Eigen::Ref<Eigen::VectorXcd> b)
+{
+	const int n = n_coefficients();
+	const int n_vertices = mesh.n_vertices();
+	const bool soft = !constraints_weights.empty();
+
+	// Hard constraints average the values transported from the constrained faces
+	// around the vertex, soft ones add up
+	vertex_weight.assign(n_vertices, 0.0);
+	vertex_count.assign(n_vertices, 0);
+	vertex_fixed.assign(n_vertices, false);
+
+	b.setZero();
+	for (int i = 0; i < constraints_faces.size(); ++i)
+	{
+		auto coefficients = constraint_coefficients(constraints_directions[i]);
+		double w = soft ? constraints_weights[i] : 1.0;
+
+		for (int c = 3 * constraints_faces[i].idx(); c < 3 * (constraints_faces[i].idx() + 1); ++c)
+		{
+			int vertex = corner_vertex[c];
+			if (soft)
+				vertex_weight[vertex] += w;
+			++vertex_count[vertex];
+			for (int k = 0; k < n; ++k)
+				b[n * vertex + k] += w * std::conj(corner_transport[k][c]) * coefficients[k];
+		}
+	}
+
+	if (!soft)
+		for (int vertex = 0; vertex < n_vertices; ++vertex)
+			if (vertex_count[vertex] > 0)
+			{
+				b.segment(n * vertex, n) /= vertex_count[vertex];
+				vertex_fixed[vertex] = true;
+			}
+
+	component_constrained.assign(component_size.size(), false);
+	for (int vertex = 0; vertex < n_vertices; ++vertex)
+		if (vertex_count[vertex] > 0)
+			component_constrained[vertex_component[vertex]] = true;
+
+	unconstrained_components.clear();
+	for (int c = 0; c < component_size.size(); ++c)
+		if (!component_constrained[c])
+			unconstrained_components.push_back(c);
+}
+
+void VertexCrossField::assemble_system()
+{
+	const int n = n_coefficients();
+	const int n_vertices = mesh.n_vertices();
+	const int rows = n * n_vertices;
+	auto &ws = *workspace;
+
+	// Same Hermitian connection Laplacian as CrossFieldOperator, over the edges;
+	// the columns of fixed vertices go to the rhs (eliminate_fixed_vertices)
+	triplets.clear();
+	triplets.reserve(rows + 2 * n * mesh.n_edges());
+
+	auto &diagonal = ws.diagonal;
+	ws.fit(diagonal, rows, 1);
+	for (int vertex = 0; vertex < n_vertices; ++vertex)
+		for (int k = 0; k < n; ++k)
+			diagonal[n * vertex + k] = vertex_fixed[vertex] ? 1.0 : vertex_weight[vertex];
+
+	for (Eigen::Index e = 0; e < edge_from.size(); ++e)
+	{
+		int i = edge_from[e], j = edge_to[e];
+		for (int k = 0; k < n; ++k)
+		{
+			complexd c_i = from_conj_pow[k][e], c_j = to_conj_pow[k][e];
+			complexd a_ij = -std::conj(c_i) * c_j;
+
+			if (!vertex_fixed[i])
+			{
+				diagonal[n * i + k] += std::norm(c_i);
+				if (!vertex_fixed[j])
+					triplets.push_back({n * i + k, n * j + k, a_ij});
+			}
+			if (!vertex_fixed[j])
+			{
+				diagonal[n * j + k] += std::norm(c_j);
+				if (!vertex_fixed[i])
+					triplets.push_back({n * j + k, n * i + k, std::conj(a_ij)});
+			}
+		}
+	}
+
+	// The shift keeps the system defined on a component without constraints, which
+	// is singular when it has no holonomy (as in CrossField)
+	if (!unconstrained_components.empty())
+	{
+		std::vector<double> shift(component_size.size(), 0.0);
+		for (int r = 0; r < rows; ++r)
+			shift[vertex_component[r / n]] += diagonal[r].real();
+		for (int c = 0; c < shift.size(); ++c)
+			shift[c] = 1e-8 * std::max(shift[c] / (n * component_size[c]), 1.0);
+
+		for (int r = 0; r < rows; ++r)
+			if (!component_constrained[vertex_component[r / n]])
+				diagonal[r] += shift[vertex_component[r / n]];
+	}
+
+	for (int r = 0; r < rows; ++r)
+	{
+		// isolated vertices
+		if (diagonal[r] == 0.0)
+			diagonal[r] = 1.0;
+		triplets.push_back({r, r, diagonal[r]});
+	}
+
+	A.resize(rows, rows);
+	A.setFromTriplets(triplets.begin(), triplets.end());
+
+	assembled_weight = vertex_weight;
+	assembled_fixed = vertex_fixed;
+	system_ready = true;
+}
+
+void VertexCrossField::eliminate_fixed_vertices(Eigen::Ref<Eigen::VectorXcd> b) const
+{
+	const int n = n_coefficients();
+
+	// Only the rows of free vertices change, so the values of the fixed ones can be
+	// read from b as it is updated
+	for (Eigen::Index e = 0; e < edge_from.size(); ++e)
+	{
+		int i = edge_from[e], j = edge_to[e];
+		if (vertex_fixed[i] == vertex_fixed[j])
+			continue;
+
+		for (int k = 0; k < n; ++k)
+		{
+			complexd a_ij = -std::conj(from_conj_pow[k][e]) * to_conj_pow[k][e];
+			if (vertex_fixed[j])
+				b[n * i + k] -= a_ij * b[n * j + k];
+			else
+				b[n * j + k] -= std::conj(a_ij) * b[n * i + k];
+		}
+	}
+}
+
+SolveStatus VertexCrossField::solve_vector_field(SolveControl &control)
+{
+	const int rows = n_coefficients() * mesh.n_vertices();
+	auto &ws = *workspace;
+
+	control.report(SolveStage::Assembly);
+
+	auto &b = ws.rhs;
+	ws.fit(b, rows, 1);
+	gather_constraints(b);
+
+	bool new_pattern = !system_ready || vertex_fixed != assembled_fixed;
+	bool new_values = new_pattern || vertex_weight != assembled_weight;
+	if (new_values)
+		assemble_system();
+	eliminate_fixed_vertices(b);
+
+	SolveStatus status = SolveStatus::Converged;
+	if (control.interrupted(status))
+		return status;
+
+	auto type = solver_backend != SolverBackendType::Auto
+					? solver_backend
+					: solver_policy.choose(rows, A.nonZeros(), Eigen::nbThreads());
+	last_backend = type;
+
+	if (!warm_start || x.size() != rows)
+		x.setZero(rows);
+
+	// The unconstrained components are solved apart, by solve_unconstrained, which
+	// starts from the field they had
+	const int n = n_coefficients();
+	if (!unconstrained_components.empty())
+	{
+		ws.fit(ws.eigen_y, rows, 1);
+		ws.eigen_y = x;
+		for (int r = 0; r < rows; ++r)
+			if (!component_constrained[vertex_component[r / n]])
+				x[r] = 0.0;
+	}
+
+	const bool iterative = type == SolverBackendType::ConjugateGradient;
+	if (iterative)
+	{
+		auto &inv_diagonal = ws.inv_diagonal;
+		ws.fit(inv_diagonal, rows, 1);
+		inv_diagonal = A.diagonal().cwiseInverse();
+
+		auto monitor = [&](int iteration, double error)
+		{
+			control.report(SolveStage::Iteration, iteration, error);
+			return !control.interrupted(status);
+		};
+
+		auto result = conjugate_gradient(A, b, x, ws, solver_policy.tolerance, 2 * rows, monitor);
+		if (!result.converged && status == SolveStatus::Converged)
+			status = SolveStatus::NotConverged;
+	}
+	else
+	{
+		// The backend is only kept once it has factored the current matrix
+		bool new_solver = !solver || solver->type() != type;
+		if (new_solver || new_values)
+		{
+			control.report(SolveStage::Factorization);
+			auto backend = new_solver ? make_solver_backend(type, solver_policy.tolerance) : std::move(solver);
+			if (new_solver || new_pattern)
+				backend->analyze_pattern(A);
+			backend->factorize(A);
+			solver = std::move(backend);
+		}
+
+		if (!solver->solve(b, x))
+			status = SolveStatus::NotConverged;
+	}
+
+	// Interrupted solves leave the unconstrained components at zero
+	if (status == SolveStatus::Converged || status == SolveStatus::NotConverged)
+	{
+		SolveStatus smoothest_status = solve_unconstrained(iterative, control);
+		if (smoothest_status != SolveStatus::Converged)
+			status = smoothest_status;
+	}
+	return status;
+}
+
+SolveStatus VertexCrossField::solve_unconstrained(bool iterative, SolveControl &control)
+{
+	SolveStatus status = SolveStatus::Converged;
+	if (unconstrained_components.empty())
+		return status;
+
+	const int n = n_coefficients();
+	const int rows = n * mesh.n_vertices();
+	const int n_components = component_size.size();
+
+	if (smoothest_field.size() != rows)
+		smoothest_field.setZero(rows);
+
+	bool all_ready = std::all_of(unconstrained_components.begin(), unconstrained_components.end(), [&](int c)
+								 { return smoothest_ready[c]; });
+	if (!all_ready)
+	{
+		// Without constraints the smoothest field is the eigenvector of the smallest
+		// eigenvalue, found by inverse iteration on each unconstrained component. The
+		// components are decoupled (the rows of the others are zero), so one solve
+		// covers all of them, as in CrossField::solve_unconstrained.
+		auto &ws = *workspace;
+		auto &y = ws.eigen_y, &z = ws.eigen_z;
+		ws.fit(z, rows, 1);
+
+		std::vector<char> pending(n_components, false);
+		for (int c : unconstrained_components)
+			pending[c] = !smoothest_ready[c];
+		auto component = [&](int r)
+		{
+			return vertex_component[r / n];
+		};
+
+		// Per component <u, v>, over the pending components
+		std::vector<complexd> dot(n_components);
+		auto component_dot = [&](const Eigen::VectorXcd &u, const Eigen::VectorXcd &v)
+		{
+			std::fill(dot.begin(), dot.end(), 0.0);
+			for (int r = 0; r < rows; ++r)
+				if (pending[component(r)])
+					dot[component(r)] += std::conj(u[r]) * v[r];
+		};
+		auto normalize_components = [&](Eigen::VectorXcd &v)
+		{
+			component_dot(v, v);
+			for (int r = 0; r < rows; ++r)
+				v[r] = pending[component(r)] ? v[r] / std::sqrt(dot[component(r)].real()) : 0.0;
+		};
+
+		// y holds the field before the solve (zero without a warm start)
+		component_dot(y, y);
+		for (int r = 0; r < rows; ++r)
+			if (pending[component(r)] && dot[component(r)].real() == 0)
+				y[r] = 1.0;
+		normalize_components(y);
+
+		// Iterative solves only need to point towards the eigenvector, not to solve exactly
+		const double inner_tolerance = std::max(solver_policy.tolerance, 1e-6);
+		auto monitor = [&](int, double)
+		{
+			return !control.interrupted(status);
+		};
+		auto inverse_step = [&]
+		{
+			if (!iterative)
+			{
+				solver->solve(y, z);
+				return;
+			}
+
+			// Start from y divided by its Rayleigh quotient, the solution for an exact
+			// eigenvector, so that loose inner solves are enough
+			z.noalias() = A * y;
+			component_dot(y, z);
+			for (int r = 0; r < rows; ++r)
+				z[r] = pending[component(r)] ? y[r] / dot[component(r)] : 0.0;
+			conjugate_gradient(A, y, z, ws, inner_tolerance, 2 * rows, monitor);
+		};
+
+		bool converged = false;
+		for (int iteration = 0; iteration < 100; ++iteration)
+		{
+			inverse_step();
+			normalize_components(z);
+
+			component_dot(y, z);
+			converged = std::all_of(unconstrained_components.begin(), unconstrained_components.end(), [&](int c)
+									{ return !pending[c] || 1 - std::abs(dot[c]) < 1e-12; });
+			y.swap(z);
+
+			if (converged || control.interrupted(status))
+				break;
+		}
+
+		// Unit-length crosses on average; only a converged eigenvector is kept
+		if (!converged && status == SolveStatus::Converged)
+			status = SolveStatus::NotConverged;
+		for (int r = 0; r < rows; ++r)
+			if (pending[component(r)])
+				smoothest_field[r] = y[r] * std::sqrt(double(component_size[component(r)]));
+		for (int c : unconstrained_components)
+			if (pending[c])
+				smoothest_ready[c] = status == SolveStatus::Converged;
+	}
+
+	for (int r = 0; r < rows; ++r)
+		if (!component_constrained[vertex_component[r / n]])
+			x[r] = smoothest_field[r];
+	return status;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <complex>
+#include <memory>
+
+#include <Eigen/Sparse>
+
+#include "Mesh.h"
+#include "GeometryKernels.h"
+#include "CrossField.h"
+#include "SolverWorkspace.h"
+#include "SolveControl.h"
+#include "SolverBackend.h"
+
+// Cross field discretized on vertices instead of faces. A closed triangle mesh has
+// about half as many vertices as faces, so the system has half the unknowns and
+// fewer non-zeros per row than CrossField's.
+//
+// Constraints are still given per face, in the local frame of the face (the same
+// input as CrossField), and are transported to the vertices of the face. The
+// field is extracted per face by averaging the transported vertex coefficients.
+//
+// The assembled system and its factorization are kept between solves: new
+// constraint values only solve again, new weights or constraint faces refactor.
+// Connected components without any constraint get their smoothest field, as in
+// CrossField.
+class VertexCrossField
+{
+public:
+	using FieldType = CrossField::FieldType;
+
+	VertexCrossField(Mesh &input_mesh, FieldType type = FieldType::Cross);
+
+	void set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+						 const std::vector<Eigen::Vector2d> &directions);
+	void set_constraints(const std::vector<Mesh::FaceHandle> &faces,
+						 const std::vector<std::array<Eigen::Vector2d, 2>> &frames);
+
+	void set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+							  const std::vector<Eigen::Vector2d> &directions,
+							  const std::vector<double> &weights);
+	void set_soft_constraints(const std::vector<Mesh::FaceHandle> &faces,
+							  const std::vector<std::array<Eigen::Vector2d, 2>> &frames,
+							  const std::vector<double> &weights);
+
+	// Frames and connection are kept between solves; call after moving vertices
+	void update_geometry() { geometry_ready = false; }
+
+	// Iterative solves start from the current field instead of zero
+	void set_warm_start(bool enabled) { warm_start = enabled; }
+
+	// Linear solver, as for CrossField (Auto picks one with the policy)
+	void set_solver_backend(SolverBackendType type)
+	{
+		solver_backend = type;
+		solver.reset();
+	}
+	void set_solver_policy(const SolverPolicy &policy)
+	{
+		solver_policy = policy;
+		solver.reset();
+	}
+	const SolverPolicy &get_solver_policy() const { return solver_policy; }
+	SolverBackendType last_solver_backend() const { return last_backend; }
+
+	void set_workspace(std::shared_ptr<SolverWorkspace> ws) { workspace = std::move(ws); }
+	const std::shared_ptr<SolverWorkspace> &get_workspace() const { return workspace; }
+
+	// Throws if an iterative solver, or the inverse iteration for a component
+	// without constraints, does not converge
+	void solve();
+
+	// Reports progress and stops at the deadline, like CrossField::solve
+	SolveStatus solve(const SolveOptions &options);
+
+	// One cross (or PolyVector frame) per face, like CrossField::extract_cross_field.
+	// The extract_* functions throw until a solve has produced a field for the
+	// current geometry.
+	std::vector<Eigen::Vector3d[4]> extract_cross_field();
+	void extract_cross_field(std::vector<Eigen::Vector3d[4]> &cross_field);
+
+	// One cross per vertex, in the tangent plane of the vertex
+	std::vector<Eigen::Vector3d[4]> extract_vertex_cross_field();
+
+private:
+	using complexd = std::complex<double>;
+	using ConstraintFrames = std::vector<std::array<complexd, 2>>;
+
+	Mesh &mesh;
+
+	FieldType field_type;
+
+	std::vector<Mesh::FaceHandle> constraints_faces;
+	ConstraintFrames constraints_directions;
+	std::vector<double> constraints_weights; // empty for hard constraints
+
+	// Local frames: rows [0, n_faces) for faces, then one row per vertex
+	struct LocalFrame
+	{
+		GeometryKernels::Vec3Array n;
+		GeometryKernels::Vec3Array u;
+		GeometryKernels::Vec3Array v;
+	};
+
+	LocalFrame local_frame;
+
+	// Connection across each edge, conj(e)^4 for x_0 and conj(e)^2 for x_2, in the
+	// frames of the two end vertices
+	Eigen::ArrayXi edge_from, edge_to;
+	Eigen::ArrayXcd from_conj_pow[2], to_conj_pow[2];
+
+	// Transport from the vertex of each corner (3 per face) into the face frame
+	Eigen::ArrayXi corner_vertex;
+	Eigen::ArrayXcd corner_transport[2];
+
+	bool geometry_ready = false;
+	bool warm_start = false;
+
+	// Constraints per vertex: soft weights, and the vertices fixed by hard constraints
+	std::vector<double> vertex_weight;
+	std::vector<int> vertex_count; // constraint faces around the vertex
+	std::vector<char> vertex_fixed;
+
+	// Hermitian connection Laplacian over the edges; rows of fixed vertices are
+	// identity rows. Assembled again when the geometry, the fixed vertices or the
+	// weights change, and factored (or analyzed, for new fixed vertices) only then.
+	Eigen::SparseMatrix<complexd> A;
+	std::vector<Eigen::Triplet<complexd>> triplets;
+	bool system_ready = false;
+	std::vector<double> assembled_weight;
+	std::vector<char> assembled_fixed;
+
+	// Connected components; those without any constraint get the smoothest field
+	// instead, which is kept until the geometry changes
+	std::vector<int> vertex_component;
+	std::vector<int> component_size; // vertices
+	std::vector<char> component_constrained;
+	std::vector<int> unconstrained_components;
+	Eigen::VectorXcd smoothest_field;
+	std::vector<char> smoothest_ready; // per component
+
+	SolverBackendType solver_backend = SolverBackendType::Auto;
+	SolverPolicy solver_policy;
+	SolverBackendType last_backend = SolverBackendType::Auto;
+	std::unique_ptr<SolverBackend> solver;
+
+	std::shared_ptr<SolverWorkspace> workspace = std::make_shared<SolverWorkspace>();
+
+	// Interleaved per vertex: [x_0, x_2] in PolyVector mode
+	Eigen::VectorXcd x;
+
+	int n_coefficients() const { return field_type == FieldType::PolyVector ? 2 : 1; }
+	static ConstraintFrames to_constraint_frames(const std::vector<Eigen::Vector2d> &directions);
+	static ConstraintFrames to_constraint_frames(const std::vector<std::array<Eigen::Vector2d, 2>> &frames);
+	std::array<complexd, 2> constraint_coefficients(const std::array<complexd, 2> &frame) const;
+	void decode(const std::array<complexd, 2> &coefficients, const Eigen::Vector3d &u, const Eigen::Vector3d &v,
+				Eigen::Vector3d (&field)[4]) const;
+
+	void check_solved() const;
+	void prepare_geometry();
+	void compute_local_frames();
+	void compute_connection();
+	void group_components();
+	void gather_constraints(Eigen::Ref<Eigen::VectorXcd> b);
+	void assemble_system();
+	void eliminate_fixed_vertices(Eigen::Ref<Eigen::VectorXcd> b) const;
+	SolveStatus solve_vector_field(SolveControl &control);
+	SolveStatus solve_unconstrained(bool iterative, SolveControl &control);
+};
@@ -0,0 +1,28 @@
+#version 330 core
+
+// MyGL::CompactVertex
+layout (location = 0) in uvec3 position; // grid steps from the origin of the chunk
+layout (location = 1) in vec2 normal;	// octahedral
+layout (location = 2) in vec2 tex_coords;
+layout (location = 3) in uint chunk;
+
+layout (std140) uniform Matrices
+{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+};
+
+// Lower corner and step of the grid, then the origin of each chunk in steps
+uniform samplerBuffer chunk_bounds;
+
+void main()
+{
+	vec3 lower = texelFetch(chunk_bounds, 0).xyz;
+	vec3 step = texelFetch(chunk_bounds, 1).xyz;
+	vec3 origin = texelFetch(chunk_bounds, 2 + int(chunk)).xyz;
+
+	// Grid coordinates are integers below 2^24 and add exactly, so a vertex shared
+	// by several chunks gets the same position in each of them
+	gl_Position = projection * view * model * vec4(lower + (origin + vec3(position)) * step, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+// One instance per face; line k (vertices 2k and 2k + 1) goes from the center along
+// the k-th direction of the cross
+layout (location = 0) in vec3 center;
+layout (location = 1) in vec3 u;
+layout (location = 2) in vec3 v;
+layout (location = 3) in float scale;
+layout (location = 4) in float angle;
+
+layout (std140) uniform Matrices
+{
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+};
+
+void main()
+{
+	vec3 position = center;
+	if (gl_VertexID % 2 == 1)
+	{
+		float a = angle + float(gl_VertexID / 2) * 1.57079633;
+		position += scale * (cos(a) * u + sin(a) * v);
+	}
+	gl_Position = projection * view * model * vec4(position, 1.0);
+}
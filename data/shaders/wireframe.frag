@@ -0,0 +1,17 @@
+#version 330 core
+
+noperspective in vec3 edge_distance;
+
+out vec4 FragColor;
+
+uniform vec4 color;
+uniform vec4 wire_color;
+uniform float wire_width; // in pixels
+
+void main()
+{
+	// Blend over one pixel at the border of the line to avoid aliasing
+	float d = min(edge_distance.x, min(edge_distance.y, edge_distance.z));
+	float wire = 1.0 - clamp(d - 0.5 * wire_width + 0.5, 0.0, 1.0);
+	FragColor = mix(color, wire_color, wire);
+}
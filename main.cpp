@@ -2,38 +2,18 @@
 
 #include "Mesh.h"
 #include "CrossField.h"
+#include "BackgroundSolver.h"
+#include "GlyphGeometry.h"
 
 #include "MyGL/Window.h"
 #include "MyGL/Mesh.h"
-#include "MyGL/LineSegment.h"
+#include "MyGL/CrossGlyphs.h"
+#include "MyGL/GlyphLOD.h"
+#include "MyGL/UniformBuffer.h"
+#include "MyGL/PerfOverlay.h"
 
 #include <iostream>
 
-std::tuple<double, Eigen::Vector3d>
-incircle(const Eigen::Vector3d &A,
-		 const Eigen::Vector3d &B,
-		 const Eigen::Vector3d &C)
-{
-	// Compute the lengths of the sides of the triangle
-	double a = (B - C).norm();
-	double b = (A - C).norm();
-	double c = (A - B).norm();
-
-	// Compute the semi-perimeter of the triangle
-	double s = (a + b + c) / 2.0;
-
-	// Compute the area of the triangle using Heron's formula
-	double area = std::sqrt(s * (s - a) * (s - b) * (s - c));
-
-	// Compute the radius of the incircle
-	double radius = area / s;
-
-	// Compute the incenter coordinates
-	Eigen::Vector3d incenter = (a * A + b * B + c * C) / (a + b + c);
-
-	return {radius, incenter};
-}
-
 int main()
 {
 	// Cross field computation
@@ -57,44 +37,16 @@ int main()
 	constraints_faces.push_back(mesh.face_handle(0));
 	constraints_directions.push_back(Eigen::Vector2d(1, 0));
 
-	// Compute cross field
+	// The frames are known before solving; the field is solved in the background
 	CrossField cross_field(mesh);
-	cross_field.set_constraints(constraints_faces, constraints_directions);
-	cross_field.solve();
-	auto cross_field_vectors = cross_field.extract_cross_field();
-
-	// Create line segments for visualization
-	OpenMesh::FProp<Eigen::Vector3d> incircle_center(mesh);
-	double mean_radius = 0;
-	for (const auto &f : mesh.faces())
-	{
-		auto [radius, center] = incircle(mesh.point(f.halfedge().from()),
-										 mesh.point(f.halfedge().to()),
-										 mesh.point(f.halfedge().next().to()));
-		mean_radius += radius;
-		incircle_center[f] = center;
-	}
-	mean_radius /= mesh.n_faces();
+	cross_field.prepare();
 
-	std::vector<glm::vec3> ls_vertices;
-	std::vector<GLuint> ls_indices;
-	ls_vertices.resize(mesh.n_faces() * 5);
-	ls_indices.resize(mesh.n_faces() * 10);
-	for (const auto &f : mesh.faces())
-	{
-		ls_vertices[5 * f.idx() + 0] = {incircle_center[f].x(),
-										incircle_center[f].y(),
-										incircle_center[f].z()};
-		for (int i = 0; i < 4; ++i)
-		{
-			auto to_vertex = incircle_center[f] + 0.5f * mean_radius * cross_field_vectors[f.idx()][i];
-			ls_vertices[5 * f.idx() + i + 1] = {to_vertex.x(),
-												to_vertex.y(),
-												to_vertex.z()};
-			ls_indices[10 * f.idx() + 2 * i] = 5 * f.idx();
-			ls_indices[10 * f.idx() + 2 * i + 1] = 5 * f.idx() + i + 1;
-		}
-	}
+	std::vector<std::array<Eigen::Vector3d, 2>> local_frames;
+	cross_field.extract_local_frames(local_frames);
+
+	// Glyph frames for visualization (kept on the CPU for the level of detail)
+	std::vector<MyGL::GlyphFrame> glyph_frames(mesh.n_faces());
+	build_glyph_frames(mesh, local_frames, static_cast<float>(glyph_arm_length(mesh)), glyph_frames.data());
 
 	// Visualize
 	// =========
@@ -125,16 +77,36 @@ int main()
 		for (const auto &vertex : mesh.fv_range(face))
 			indices.push_back(vertex.idx());
 
-	MyGL::Mesh gl_mesh(vertices, indices);
-
-	// Construct line segments
-	MyGL::LineSegment ls(ls_vertices, ls_indices);
-
-	// Load shader from file
-	MyGL::ShaderProgram basic;
+	// Chunks of up to 4096 triangles, so that zoomed-in views only draw what is on screen,
+	// stored compactly (16-bit positions within each chunk and 16-bit indices)
+	MyGL::Mesh gl_mesh(vertices, indices, GL_STATIC_DRAW, 4096, MyGL::VertexFormat::Compact);
+
+	// Cross glyphs of the faces picked by the level of detail for the current view
+	// (drawn at angle zero until the first solve finishes)
+	std::vector<glm::vec3> glyph_centers(glyph_frames.size());
+	for (size_t i = 0; i < glyph_frames.size(); i++)
+		glyph_centers[i] = glyph_frames[i].center;
+	MyGL::GlyphLOD glyph_lod(glyph_centers);
+	MyGL::CrossGlyphs glyphs({}, GL_STREAM_DRAW);
+
+	std::vector<float> cross_angles(mesh.n_faces(), 0.0f);
+	std::vector<MyGL::GlyphFrame> lod_frames;
+	std::vector<float> lod_angles;
+
+	// From here on, only the solver thread uses cross_field
+	BackgroundSolver solver(cross_field);
+	solver.submit(constraints_faces, constraints_directions);
+	BackgroundSolver::Result solve_result;
+	float constraint_angle = 0.0f;
+
+	// Load shader from file (or from the binary cache of an earlier run)
+	MyGL::ShaderProgram::set_binary_cache_directory("shader_cache");
+	MyGL::ShaderProgram surface, glyph;
 	try
 	{
-		basic.load_from_file("data/shaders/basic.vert", "data/shaders/basic.frag");
+		// Faces and their edges in one pass
+		surface.load_from_file("data/shaders/compact.vert", "data/shaders/wireframe.frag", "data/shaders/wireframe.geom");
+		glyph.load_from_file("data/shaders/glyph.vert", "data/shaders/basic.frag");
 	}
 	catch (const std::exception &e)
 	{
@@ -142,15 +114,38 @@ int main()
 		exit(EXIT_FAILURE);
 	}
 
+	// model, view and projection are shared through a uniform buffer
+	MyGL::UniformBuffer<MyGL::Matrices> matrices(MyGL::MATRICES_BINDING);
+	surface.bind_uniform_block("Matrices", MyGL::MATRICES_BINDING);
+	glyph.bind_uniform_block("Matrices", MyGL::MATRICES_BINDING);
+	GLint surface_viewport = surface.get_uniform_location("viewport");
+	surface.use();
+	surface.set_uniform("chunk_bounds", static_cast<int>(MyGL::CHUNK_BOUNDS_TEXTURE_UNIT));
+	surface.set_uniform("color", glm::vec4(1.0f, 0.5f, 0.2f, 1.0f));
+	surface.set_uniform("wire_color", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+	surface.set_uniform("wire_width", 1.0f);
+	GLint glyph_color = glyph.get_uniform_location("color");
+
 	// Set up camera
 	MyGL::OrbitCamera camera(center);
 	camera.set_position({0.0f, 0.0f, 1.0f});
 
 	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
+	// Frame timings, GPU time per pass and solver stats
+	enum Pass
+	{
+		MESH,
+		GLYPHS
+	};
+	MyGL::PerfOverlay overlay({"mesh", "glyphs"});
+	MyGL::SolverStats solver_stats;
+
 	// Main loop
 	while (!window.should_close())
 	{
+		overlay.begin_frame();
+
 		// per-frame time logic
 		float current_frame_time = static_cast<float>(glfwGetTime());
 		delta_time = current_frame_time - last_frame_time;
@@ -162,30 +157,74 @@ int main()
 
 		camera.look_at(center);
 
-		// update mvp matrices
-		basic.use();
+		// left / right arrows rotate the constraint; only the latest edit is solved
+		int rotation = window.is_key_pressed(GLFW_KEY_RIGHT) - window.is_key_pressed(GLFW_KEY_LEFT);
+		if (rotation != 0)
+		{
+			constraint_angle += rotation * delta_time;
+			constraints_directions[0] = Eigen::Vector2d(std::cos(constraint_angle), std::sin(constraint_angle));
+			solver.submit(constraints_faces, constraints_directions);
+		}
 
+		// take a new field without waiting for the solver
+		bool field_changed = false;
+		if (solver.poll(solve_result))
+		{
+			if (solve_result.error.empty())
+			{
+				cross_angles.swap(solve_result.angles);
+				field_changed = true;
+				solver_stats.edit = solve_result.edit;
+				solver_stats.seconds = solve_result.seconds;
+				solver_stats.backend = to_string(solve_result.backend);
+			}
+			else
+				std::cerr << solve_result.error << std::endl;
+		}
+		solver_stats.busy = solver.busy();
+		overlay.set_solver_stats(solver_stats);
+
+		// update mvp matrices
 		glm::mat4 model = glm::mat4(1.0f);
 		glm::mat4 view = camera.get_view_matrix() * camera.get_model_matrix();
 		auto [width, height] = window.get_framebuffer_size();
 		glm::mat4 projection = camera.get_projection_matrix(static_cast<float>(width) / height);
-		basic.set_uniform("model", model);
-		basic.set_uniform("view", view);
-		basic.set_uniform("projection", projection);
+		matrices.update({model, view, projection});
+
+		// glyphs about 20 pixels apart, gathered again when the view or the field changes
+		if (glyph_lod.select(view, projection, height, 20.0f) || field_changed)
+		{
+			glyph_lod.gather(glyph_frames, cross_angles, lod_frames, lod_angles);
+			glyphs.set_frames(lod_frames);
+			glyphs.set_angles(lod_angles);
+		}
 
 		// render
 		// ======
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// mesh
-		basic.set_uniform("color", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-		gl_mesh.draw_wireframe();
-		basic.set_uniform("color", glm::vec4(1.0f, 0.5f, 0.2f, 1.0f));
-		gl_mesh.draw();
+		// mesh with its wireframe
+		surface.use();
+		surface.set_uniform(surface_viewport, glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+		MyGL::Frustum frustum(projection * view * model);
+		overlay.begin_pass(MESH);
+		gl_mesh.draw(frustum);
+		overlay.count_draw(gl_mesh.get_n_drawn_triangles());
+		overlay.end_pass();
 
 		// vector field
-		basic.set_uniform("color", glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
-		ls.draw();
+		glyph.use();
+		glyph.set_uniform(glyph_color, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+		overlay.begin_pass(GLYPHS);
+		glyphs.draw();
+		overlay.count_draw(glyphs.get_n_drawn_lines());
+		overlay.end_pass();
+
+		// performance overlay
+		window.begin_ui_frame();
+		overlay.draw();
+		window.end_ui_frame();
+		overlay.end_frame();
 
 		// swap buffers and poll events
 		window.swap_buffers();
@@ -0,0 +1,426 @@
+// Cross field daemon: keeps meshes and their CrossFields (frames, connection,
+// factorizations, solver workspace) in memory between requests.
+//
+// Clients connect to a Unix domain socket, which only its owner can use (the
+// server replaces a stale socket at the path but refuses any other file), and
+// send one command per line:
+//
+//     load <asset> <path> [cross|polyvector]     -> ok <n_faces>
+//     constraints <asset> <n> {<face> <x> <y>}   hard directions
+//     frames <asset> <n> {<face> <ux> <uy> <vx> <vy>}
+//     soft <asset> <n> {<face> <x> <y> <weight>}
+//     solve <asset>                              -> ok <n_faces> <floats per face> <bytes>
+//     unload <asset>                             -> ok
+//     list                                       -> ok <asset>...
+//
+// Failed commands answer "error <message>". A line longer than 64 MiB is answered
+// with an error and closes the connection. At most 16 clients are served at once,
+// each by a thread of a fixed pool; further connections get "error too many
+// clients". SIGINT and SIGTERM stop the server once the current requests finish. solve is followed by the field as
+// native float32: per face the direction a (cross: the others are a rotated by 90
+// degree steps), or a and b for PolyVector (the others are -a and -b).
+
+#include <OpenMesh/Core/IO/MeshIO.hh>
+
+#include "Mesh.h"
+#include "CrossField.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct Asset
+	{
+		Mesh mesh;
+		std::unique_ptr<CrossField> field;
+		CrossField::FieldType type;
+
+		std::mutex mutex; // one request at a time per asset
+		std::vector<Eigen::Vector3d[4]> cross_field;
+		std::vector<float> payload;
+	};
+
+	std::mutex assets_mutex;
+	std::map<std::string, std::shared_ptr<Asset>> assets;
+
+	std::shared_ptr<Asset> find_asset(const std::string &name)
+	{
+		std::lock_guard<std::mutex> lock(assets_mutex);
+		auto it = assets.find(name);
+		if (it == assets.end())
+			throw std::invalid_argument("unknown asset " + name);
+		return it->second;
+	}
+
+	bool write_all(int fd, const void *data, size_t size)
+	{
+		auto bytes = static_cast<const char *>(data);
+		while (size > 0)
+		{
+			ssize_t written = write(fd, bytes, size);
+			if (written <= 0)
+				return false;
+			bytes += written;
+			size -= written;
+		}
+		return true;
+	}
+
+	std::string load(std::istringstream &args)
+	{
+		std::string name, path, type = "cross";
+		args >> name >> path >> type;
+		if (name.empty() || path.empty())
+			throw std::invalid_argument("usage: load <asset> <path> [cross|polyvector]");
+		if (type != "cross" && type != "polyvector")
+			throw std::invalid_argument("unknown field type " + type);
+
+		auto asset = std::make_shared<Asset>();
+		if (!OpenMesh::IO::read_mesh(asset->mesh, path))
+			throw std::runtime_error("cannot read " + path);
+
+		asset->type = type == "polyvector" ? CrossField::FieldType::PolyVector : CrossField::FieldType::Cross;
+		asset->field = std::make_unique<CrossField>(asset->mesh, asset->type);
+
+		// Frames and connection now, so that the first solve request only solves
+		asset->field->prepare();
+
+		size_t n_faces = asset->mesh.n_faces();
+		{
+			std::lock_guard<std::mutex> lock(assets_mutex);
+			assets[name] = asset;
+		}
+		return "ok " + std::to_string(n_faces);
+	}
+
+	Mesh::FaceHandle read_face(std::istringstream &args, const Mesh &mesh)
+	{
+		int f = -1;
+		args >> f;
+		if (f < 0 || f >= static_cast<int>(mesh.n_faces()))
+			throw std::invalid_argument("face index out of range");
+		return mesh.face_handle(f);
+	}
+
+	// Checked before anything is allocated for the constraints
+	int read_count(std::istringstream &args, const Mesh &mesh)
+	{
+		int n = -1;
+		args >> n;
+		if (!args || n < 0)
+			throw std::invalid_argument("missing constraint count");
+		if (n > static_cast<int>(mesh.n_faces()))
+			throw std::invalid_argument("more constraints than faces");
+		return n;
+	}
+
+	std::string constrain(const std::string &command, std::istringstream &args)
+	{
+		std::string name;
+		args >> name;
+		auto asset = find_asset(name);
+		std::lock_guard<std::mutex> lock(asset->mutex);
+
+		int n = read_count(args, asset->mesh);
+		std::vector<Mesh::FaceHandle> faces(n);
+		std::vector<Eigen::Vector2d> directions(n);
+		std::vector<std::array<Eigen::Vector2d, 2>> frames(n);
+		std::vector<double> weights(n);
+
+		for (int i = 0; i < n; ++i)
+		{
+			faces[i] = read_face(args, asset->mesh);
+			if (command == "frames")
+				args >> frames[i][0].x() >> frames[i][0].y() >> frames[i][1].x() >> frames[i][1].y();
+			else
+				args >> directions[i].x() >> directions[i].y();
+			if (command == "soft")
+				args >> weights[i];
+		}
+		if (!args)
+			throw std::invalid_argument("truncated constraint list");
+
+		if (command == "frames")
+			asset->field->set_constraints(faces, frames);
+		else if (command == "soft")
+			asset->field->set_soft_constraints(faces, directions, weights);
+		else
+			asset->field->set_constraints(faces, directions);
+
+		return "ok";
+	}
+
+	// Writes the reply line and the field itself
+	bool solve(int fd, std::istringstream &args)
+	{
+		std::string name;
+		args >> name;
+		auto asset = find_asset(name);
+		std::lock_guard<std::mutex> lock(asset->mutex);
+
+		asset->field->solve();
+		asset->field->extract_cross_field(asset->cross_field);
+
+		const int n_vectors = asset->type == CrossField::FieldType::PolyVector ? 2 : 1;
+		const size_t n_faces = asset->cross_field.size();
+
+		auto &payload = asset->payload;
+		payload.resize(3 * n_vectors * n_faces);
+		for (size_t f = 0; f < n_faces; ++f)
+			for (int k = 0; k < n_vectors; ++k)
+				for (int c = 0; c < 3; ++c)
+					payload[3 * (n_vectors * f + k) + c] = static_cast<float>(asset->cross_field[f][k][c]);
+
+		size_t bytes = payload.size() * sizeof(float);
+		std::string reply = "ok " + std::to_string(n_faces) + " " + std::to_string(3 * n_vectors) + " " +
+							std::to_string(bytes) + "\n";
+		return write_all(fd, reply.data(), reply.size()) && write_all(fd, payload.data(), bytes);
+	}
+
+	std::string unload(std::istringstream &args)
+	{
+		std::string name;
+		args >> name;
+
+		std::lock_guard<std::mutex> lock(assets_mutex);
+		if (assets.erase(name) == 0)
+			throw std::invalid_argument("unknown asset " + name);
+		return "ok";
+	}
+
+	std::string list()
+	{
+		std::lock_guard<std::mutex> lock(assets_mutex);
+		std::string reply = "ok";
+		for (const auto &[name, asset] : assets)
+			reply += " " + name;
+		return reply;
+	}
+
+	constexpr size_t max_line = size_t(64) << 20;
+
+	void serve(int fd)
+	{
+		std::string buffer;
+		char chunk[4096];
+
+		while (true)
+		{
+			// Only the new bytes are searched, so a long line is scanned once
+			size_t end, scanned = 0;
+			while ((end = buffer.find('\n', scanned)) == std::string::npos)
+			{
+				// The rest of the line cannot be skipped reliably, so give up on the client
+				if (buffer.size() > max_line)
+				{
+					std::string reply = "error line too long\n";
+					write_all(fd, reply.data(), reply.size());
+					return;
+				}
+
+				scanned = buffer.size();
+				ssize_t n = read(fd, chunk, sizeof(chunk));
+				if (n <= 0)
+					return;
+				buffer.append(chunk, n);
+			}
+
+			std::istringstream args(buffer.substr(0, end));
+			buffer.erase(0, end + 1);
+
+			std::string command;
+			args >> command;
+			if (command.empty())
+				continue;
+
+			std::string reply;
+			try
+			{
+				if (command == "solve")
+				{
+					if (!solve(fd, args))
+						break;
+					continue;
+				}
+				else if (command == "load")
+					reply = load(args);
+				else if (command == "constraints" || command == "frames" || command == "soft")
+					reply = constrain(command, args);
+				else if (command == "unload")
+					reply = unload(args);
+				else if (command == "list")
+					reply = list();
+				else
+					reply = "error unknown command " + command;
+			}
+			catch (const std::exception &e)
+			{
+				reply = std::string("error ") + e.what();
+			}
+
+			reply += "\n";
+			if (!write_all(fd, reply.data(), reply.size()))
+				break;
+		}
+	}
+
+	// Connections are handed to a fixed pool of threads, one per client
+	constexpr size_t max_clients = 16;
+
+	std::mutex clients_mutex;
+	std::condition_variable clients_ready;
+	std::deque<int> waiting; // accepted, not picked up by a worker yet
+	std::set<int> serving;
+	bool stopping = false;
+
+	void worker()
+	{
+		while (true)
+		{
+			int fd;
+			{
+				std::unique_lock<std::mutex> lock(clients_mutex);
+				clients_ready.wait(lock, []
+								   { return stopping || !waiting.empty(); });
+				if (stopping)
+					return;
+				fd = waiting.front();
+				waiting.pop_front();
+				serving.insert(fd);
+			}
+
+			serve(fd);
+
+			// Closed only once it is no longer listed, so that shutdown never sees a
+			// reused descriptor
+			{
+				std::lock_guard<std::mutex> lock(clients_mutex);
+				serving.erase(fd);
+			}
+			close(fd);
+		}
+	}
+
+	int listener = -1;
+	volatile std::sig_atomic_t stop_requested = 0;
+
+	// shutdown() is async-signal-safe and wakes the accept() of the main thread
+	void request_stop(int)
+	{
+		stop_requested = 1;
+		shutdown(listener, SHUT_RDWR);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	std::string socket_path = argc > 1 ? argv[1] : "/tmp/crossfield.sock";
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Socket path too long: " << socket_path << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::strcpy(address.sun_path, socket_path.c_str());
+
+	// Clients that disconnect mid-reply must not kill the server
+	std::signal(SIGPIPE, SIG_IGN);
+
+	// Only a stale socket left by an earlier run is replaced, never another file
+	struct stat existing;
+	if (lstat(socket_path.c_str(), &existing) == 0)
+	{
+		if (!S_ISSOCK(existing.st_mode))
+		{
+			std::cerr << "Not a socket, refusing to replace: " << socket_path << std::endl;
+			return EXIT_FAILURE;
+		}
+		unlink(socket_path.c_str());
+	}
+
+	// The socket is created accessible to its owner only
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	mode_t mask = umask(077);
+	bool bound = listener >= 0 && bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+	umask(mask);
+	if (!bound || listen(listener, 16) < 0)
+	{
+		std::cerr << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Listening on " << socket_path << std::endl;
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < max_clients; ++i)
+		workers.emplace_back(worker);
+
+	std::signal(SIGINT, request_stop);
+	std::signal(SIGTERM, request_stop);
+
+	while (!stop_requested)
+	{
+		int client = accept(listener, nullptr, nullptr);
+		if (client < 0)
+		{
+			if (stop_requested || errno == EINTR)
+				continue;
+			std::cerr << "accept: " << std::strerror(errno) << std::endl;
+			break;
+		}
+
+		std::unique_lock<std::mutex> lock(clients_mutex);
+		if (waiting.size() + serving.size() >= max_clients)
+		{
+			lock.unlock();
+			std::string reply = "error too many clients\n";
+			write_all(client, reply.data(), reply.size());
+			close(client);
+			continue;
+		}
+		waiting.push_back(client);
+		lock.unlock();
+		clients_ready.notify_one();
+	}
+
+	// Wakes the clients blocked in read() and drops those still waiting; requests
+	// being solved finish first
+	{
+		std::lock_guard<std::mutex> lock(clients_mutex);
+		stopping = true;
+		for (int fd : serving)
+			shutdown(fd, SHUT_RDWR);
+		for (int fd : waiting)
+			close(fd);
+		waiting.clear();
+	}
+	clients_ready.notify_all();
+	for (auto &thread : workers)
+		thread.join();
+
+	std::cout << "Stopped" << std::endl;
+	close(listener);
+	unlink(socket_path.c_str());
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+// Batch thumbnails of cross fields without a display:
+//
+//     CrossFieldThumbnails [--size <pixels>] <output directory> <mesh>...
+//
+// Solves the cross field of each mesh (constraint as in the viewer) and writes
+// <output directory>/<mesh name>.ppm. One offscreen context, framebuffer, set of
+// shaders and GPU buffers is shared by all meshes.
+
+#include <OpenMesh/Core/IO/MeshIO.hh>
+
+#include "Mesh.h"
+#include "CrossField.h"
+#include "GlyphGeometry.h"
+
+#include "MyGL/OffscreenContext.h"
+#include "MyGL/Framebuffer.h"
+#include "MyGL/Shader.h"
+#include "MyGL/Mesh.h"
+#include "MyGL/CrossGlyphs.h"
+#include "MyGL/UniformBuffer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Scene
+	{
+		std::vector<glm::vec3> vertices;
+		std::vector<GLuint> indices;
+		std::vector<std::array<Eigen::Vector3d, 2>> local_frames;
+		float arm_length;
+		std::vector<float> angles;
+
+		glm::vec3 center;
+		float radius;
+	};
+
+	glm::vec3 to_glm(const Eigen::Vector3d &v)
+	{
+		return {v.x(), v.y(), v.z()};
+	}
+
+	void build_scene(Mesh &mesh, Scene &scene)
+	{
+		CrossField cross_field(mesh);
+		cross_field.set_constraints({mesh.face_handle(0)}, {Eigen::Vector2d(1, 0)});
+		cross_field.solve();
+
+		cross_field.extract_local_frames(scene.local_frames);
+		cross_field.extract_cross_angles(scene.angles);
+
+		scene.vertices.clear();
+		glm::vec3 lower(std::numeric_limits<float>::max()), upper(-std::numeric_limits<float>::max());
+		for (const auto &vertex : mesh.vertices())
+		{
+			scene.vertices.push_back(to_glm(mesh.point(vertex)));
+			lower = glm::min(lower, scene.vertices.back());
+			upper = glm::max(upper, scene.vertices.back());
+		}
+		scene.center = (lower + upper) * 0.5f;
+		scene.radius = glm::length(upper - lower) * 0.5f;
+
+		scene.indices.clear();
+		for (const auto &face : mesh.faces())
+			for (const auto &vertex : mesh.fv_range(face))
+				scene.indices.push_back(vertex.idx());
+
+		scene.arm_length = static_cast<float>(glyph_arm_length(mesh));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int size = 512;
+	std::vector<std::string> arguments(argv + 1, argv + argc);
+	if (arguments.size() >= 2 && arguments[0] == "--size")
+	{
+		size = std::atoi(arguments[1].c_str());
+		arguments.erase(arguments.begin(), arguments.begin() + 2);
+	}
+	if (arguments.size() < 2 || size <= 0)
+	{
+		std::cerr << "Usage: CrossFieldThumbnails [--size <pixels>] <output directory> <mesh>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::filesystem::path output_directory = arguments[0];
+
+	int failures = 0;
+	try
+	{
+		MyGL::OffscreenContext context;
+		MyGL::Framebuffer framebuffer(size, size);
+
+		MyGL::ShaderProgram::set_binary_cache_directory("shader_cache");
+		MyGL::ShaderProgram basic, glyph;
+		basic.load_from_file("data/shaders/basic.vert", "data/shaders/basic.frag");
+		glyph.load_from_file("data/shaders/glyph.vert", "data/shaders/basic.frag");
+
+		MyGL::UniformBuffer<MyGL::Matrices> matrices(MyGL::MATRICES_BINDING);
+		basic.bind_uniform_block("Matrices", MyGL::MATRICES_BINDING);
+		glyph.bind_uniform_block("Matrices", MyGL::MATRICES_BINDING);
+		GLint basic_color = basic.get_uniform_location("color");
+		GLint glyph_color = glyph.get_uniform_location("color");
+
+		// GPU buffers are reused for every mesh
+		MyGL::Mesh gl_mesh(std::vector<glm::vec3>{}, std::vector<GLuint>{});
+		MyGL::CrossGlyphs glyphs({});
+		Scene scene;
+
+		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+		for (size_t i = 1; i < arguments.size(); ++i)
+		{
+			const std::string &path = arguments[i];
+			try
+			{
+				Mesh mesh;
+				if (!OpenMesh::IO::read_mesh(mesh, path))
+					throw std::runtime_error("Failed to read mesh: " + path);
+				// The constraint on face 0 and the bounding sphere need at least one face
+				if (mesh.n_faces() == 0)
+					throw std::runtime_error("Mesh has no faces: " + path);
+
+				build_scene(mesh, scene);
+				gl_mesh.update(scene.vertices, scene.indices);
+				// Glyph frames are built straight into the GPU buffer
+				build_glyph_frames(mesh, scene.local_frames, scene.arm_length, glyphs.map_frames(mesh.n_faces()));
+				glyphs.unmap_frames();
+				glyphs.set_angles(scene.angles);
+
+				// Fit the bounding sphere into the 45 degree field of view
+				float distance = 2.7f * scene.radius;
+				glm::mat4 model = glm::mat4(1.0f);
+				glm::mat4 view = glm::lookAt(scene.center + glm::vec3(0.0f, 0.0f, distance), scene.center,
+											 glm::vec3(0.0f, 1.0f, 0.0f));
+				glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f,
+														0.05f * scene.radius, distance + 2.0f * scene.radius);
+				matrices.update({model, view, projection});
+
+				framebuffer.bind();
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				// No wireframe: at thumbnail size it would cover the faces
+				basic.use();
+				basic.set_uniform(basic_color, glm::vec4(1.0f, 0.5f, 0.2f, 1.0f));
+				gl_mesh.draw();
+
+				glyph.use();
+				glyph.set_uniform(glyph_color, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+				glyphs.draw();
+
+				auto output = output_directory / std::filesystem::path(path).stem();
+				output += ".ppm";
+				framebuffer.save_ppm(output.string());
+				std::cout << output.string() << std::endl;
+			}
+			catch (const std::exception &e)
+			{
+				std::cerr << path << ": " << e.what() << std::endl;
+				++failures;
+			}
+		}
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}